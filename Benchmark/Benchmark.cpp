@@ -0,0 +1,301 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Corpus.h"
+#include "../Compressors/Compressor.h"
+#include "../Compressors/Huffman/Huffman.h"
+
+/**
+ * Benchmarks each stage in isolation and the whole pipeline on the synthetic corpus <br>
+ * Each stage runs on the output of the previous one, as it does when compressing <br>
+ * Throughput is in megabytes of uncompressed data per second, for encoders and decoders alike <br>
+ * Bytes/symbol is the size of the encoded data per byte of uncompressed data <br>
+ * The SIMD kernels run at the best level of the CPU, or at the one given by --cpu to compare them
+ */
+
+struct BenchmarkOptions {
+    size_t size = 4u << 20;
+    int repeat = 3;
+    std::string corpus; // empty for all of them
+    CPU::Level cpuLevel = CPU::detected();
+};
+
+// Best wall time of [repeat] runs, the fastest is the least disturbed by the rest of the system
+double measure(int repeat, const std::function<void()>& run) {
+    double bestSeconds = 0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || seconds < bestSeconds)
+            bestSeconds = seconds;
+    }
+    return bestSeconds;
+}
+
+void report(const std::string& corpus, const std::string& benchmark, size_t symbols, size_t encodedBytes,
+            double seconds) {
+    double megabytesPerSecond = seconds > 0 ? symbols / seconds / 1e6 : 0;
+    double bytesPerSymbol = symbols > 0 ? (double) encodedBytes / symbols : 0;
+    printf("%-8s %-20s %12.2f %14.4f\n", corpus.c_str(), benchmark.c_str(), megabytesPerSecond, bytesPerSymbol);
+}
+
+bool fail(const std::string& corpus, const std::string& benchmark) {
+    std::cerr << benchmark << " does not restore the " << corpus << " corpus!\n";
+    return false;
+}
+
+bool runCorpus(const std::string& name, const BenchmarkOptions& options) {
+    std::vector<uint8_t> input = Corpus::generate(name, options.size);
+    uint32_t length = input.size();
+    int repeat = options.repeat;
+
+    ScratchArena arena;
+    double seconds;
+
+    // Checksum of the blocks
+    uint32_t checksum = 0;
+    seconds = measure(repeat, [&]() {
+        checksum = CRC32C::compute(input.data(), length);
+    });
+    report(name, "CRC32C", length, sizeof(checksum), seconds);
+
+    // Long range matching, on a copy of the input after itself so the second half is one long match
+    std::vector<uint8_t> doubled(input);
+    doubled.insert(doubled.end(), input.begin(), input.end());
+    std::vector<uint8_t> longRange(LongRange::encodeBound(doubled.size()));
+    size_t longRangeSize = 0;
+    seconds = measure(repeat, [&]() {
+        longRangeSize = LongRange::encode(doubled.data(), doubled.size(), longRange.data(), length, arena);
+    });
+    report(name, "LongRange encode", doubled.size(), longRangeSize, seconds);
+
+    // Numeric filter detected on the start of the input, or a delta of 4 bytes values if none is
+    NumericTransform::Filter filter = NumericTransform::detect(input.data(), std::min(length, 64u << 10));
+    if (!NumericTransform::isValid(filter)) {
+        filter.operation = NumericTransform::Operation::DELTA;
+        filter.width = filter.stride = 4;
+    }
+    std::vector<uint8_t> filtered(length);
+    seconds = measure(repeat, [&]() {
+        NumericTransform::encode(input.data(), length, filtered.data(), filter);
+    });
+    report(name, "Numeric encode", length, length, seconds);
+
+    std::vector<uint8_t> unfiltered(length);
+    seconds = measure(repeat, [&]() {
+        NumericTransform::decode(filtered.data(), length, unfiltered.data(), filter);
+    });
+    report(name, "Numeric decode", length, length, seconds);
+    if (unfiltered != input)
+        return fail(name, "NumericTransform");
+
+    // Suffix Array
+    std::vector<uint32_t> suffixArray(length);
+    seconds = measure(repeat, [&]() {
+        SuffixArray::buildSuffixArray(input.data(), length, suffixArray.data(), arena);
+    });
+    report(name, "SuffixArray", length, (size_t) length * sizeof(uint32_t), seconds);
+
+    // BWT, the encoding uses the suffix array built above
+    std::vector<uint8_t> bwt(length + 1);
+    uint32_t originalIndex = 0;
+    seconds = measure(repeat, [&]() {
+        originalIndex = BWT::encode(input.data(), length, suffixArray.data(), bwt.data());
+    });
+    report(name, "BWT encode", length, bwt.size(), seconds);
+
+    std::vector<uint8_t> inverseBWT(length);
+    seconds = measure(repeat, [&]() {
+        BWT::decode(bwt.data(), bwt.size(), originalIndex, inverseBWT.data(), arena);
+    });
+    report(name, "BWT decode", length, bwt.size(), seconds);
+    if (inverseBWT != input)
+        return fail(name, "BWT");
+
+    // MTF, in place so each run starts from a fresh copy
+    std::vector<uint8_t> mtf(bwt.size());
+    seconds = measure(repeat, [&]() {
+        memcpy(mtf.data(), bwt.data(), bwt.size());
+        MTF::encode(mtf.data(), mtf.size());
+    });
+    report(name, "MTF encode", bwt.size(), mtf.size(), seconds);
+
+    std::vector<uint8_t> inverseMTF(mtf.size());
+    seconds = measure(repeat, [&]() {
+        memcpy(inverseMTF.data(), mtf.data(), mtf.size());
+        MTF::decode(inverseMTF.data(), inverseMTF.size());
+    });
+    report(name, "MTF decode", bwt.size(), mtf.size(), seconds);
+    if (inverseMTF != bwt)
+        return fail(name, "MTF");
+
+    // MTF split between the threads of the machine, it must give the same bytes
+    uint32_t numberOfThreads = std::thread::hardware_concurrency();
+    ThreadPool mtfHelpers(numberOfThreads > 1 ? numberOfThreads - 1 : 1);
+    MTF::Encoder mtfEncoder;
+    MTF::Decoder mtfDecoder;
+    mtfEncoder.setHelpers(&mtfHelpers);
+    mtfDecoder.setHelpers(&mtfHelpers);
+
+    std::vector<uint8_t> parallelMTF(bwt.size());
+    seconds = measure(repeat, [&]() {
+        memcpy(parallelMTF.data(), bwt.data(), bwt.size());
+        mtfEncoder.reset();
+        mtfEncoder.encode(parallelMTF.data(), parallelMTF.size());
+    });
+    report(name, "MTF encode parallel", bwt.size(), parallelMTF.size(), seconds);
+    if (parallelMTF != mtf)
+        return fail(name, "MTF encode parallel");
+
+    seconds = measure(repeat, [&]() {
+        memcpy(parallelMTF.data(), mtf.data(), mtf.size());
+        mtfDecoder.reset();
+        mtfDecoder.decode(parallelMTF.data(), parallelMTF.size());
+    });
+    report(name, "MTF decode parallel", bwt.size(), mtf.size(), seconds);
+    if (parallelMTF != bwt)
+        return fail(name, "MTF decode parallel");
+
+    // LZW
+    LZW::Encoder lzwEncoder(arena);
+    LZW::Decoder lzwDecoder(arena);
+    std::vector<uint8_t> lzw(Compressor::compressBlockBound(mtf.size()));
+    size_t lzwSize = 0;
+    seconds = measure(repeat, [&]() {
+        BitWriter writer(lzw.data(), lzw.size());
+        lzwEncoder.encode(mtf.data(), mtf.size(), writer);
+        lzwSize = writer.flush();
+    });
+    report(name, "LZW encode", mtf.size(), lzwSize, seconds);
+
+    std::vector<uint8_t> inverseLZW(mtf.size());
+    seconds = measure(repeat, [&]() {
+        BitReader reader(lzw.data(), lzwSize);
+        LZW::BufferSink sink(inverseLZW.data(), inverseLZW.size());
+        lzwDecoder.decode(reader, sink);
+    });
+    report(name, "LZW decode", mtf.size(), lzwSize, seconds);
+    if (inverseLZW != mtf)
+        return fail(name, "LZW");
+
+    // Huffman, on the MTF output where it would replace LZW
+    Huffman::Encoder huffmanEncoder;
+    Huffman::Decoder huffmanDecoder;
+    std::vector<uint8_t> huffman(2 * mtf.size() + (1u << 16));
+    size_t huffmanSize = 0;
+    seconds = measure(repeat, [&]() {
+        huffmanSize = huffmanEncoder.encode(mtf.data(), mtf.size(), huffman.data(), huffman.size());
+    });
+    report(name, "Huffman encode", mtf.size(), huffmanSize, seconds);
+
+    std::vector<uint8_t> inverseHuffman(mtf.size());
+    size_t inverseHuffmanSize = 0;
+    seconds = measure(repeat, [&]() {
+        inverseHuffmanSize = huffmanDecoder.decode(huffman.data(), huffmanSize, inverseHuffman.data(),
+                                                   inverseHuffman.size());
+    });
+    report(name, "Huffman decode", mtf.size(), huffmanSize, seconds);
+    if (inverseHuffmanSize != mtf.size() || inverseHuffman != mtf)
+        return fail(name, "Huffman");
+
+    // Whole pipeline, with the container format
+    Compressor::Context context;
+    std::vector<uint8_t> compressed(Compressor::compressBound(length));
+    size_t compressedSize = 0;
+    seconds = measure(repeat, [&]() {
+        compressedSize = Compressor::compress(input.data(), length, compressed.data(), compressed.size(),
+                                              Compressor::Options(), context);
+    });
+    report(name, "Compress", length, compressedSize, seconds);
+
+    std::vector<uint8_t> decompressed(length);
+    size_t decompressedSize = 0;
+    seconds = measure(repeat, [&]() {
+        decompressedSize = Compressor::decompress(compressed.data(), compressedSize, decompressed.data(),
+                                                  decompressed.size(), context);
+    });
+    report(name, "Decompress", length, compressedSize, seconds);
+    if (decompressedSize != length || decompressed != input)
+        return fail(name, "Compressor");
+
+    // Whole pipeline with the numeric filter detected for each block
+    Compressor::Options numericOptions;
+    numericOptions.numericFilter.operation = NumericTransform::Operation::DETECT;
+    seconds = measure(repeat, [&]() {
+        compressedSize = Compressor::compress(input.data(), length, compressed.data(), compressed.size(),
+                                              numericOptions, context);
+    });
+    report(name, "Compress numeric", length, compressedSize, seconds);
+
+    seconds = measure(repeat, [&]() {
+        decompressedSize = Compressor::decompress(compressed.data(), compressedSize, decompressed.data(),
+                                                  decompressed.size(), context);
+    });
+    report(name, "Decompress numeric", length, compressedSize, seconds);
+    if (decompressedSize != length || decompressed != input)
+        return fail(name, "Compressor");
+
+    return true;
+}
+
+bool parseOptions(int argc, char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        try {
+            if (option == "--size" && hasValue) {
+                options.size = std::stoull(argv[++i]);
+            } else if (option == "--repeat" && hasValue) {
+                options.repeat = std::stoi(argv[++i]);
+            } else if (option == "--corpus" && hasValue) {
+                options.corpus = argv[++i];
+            } else if (option == "--cpu" && hasValue) {
+                if (!CPU::parse(argv[++i], options.cpuLevel))
+                    return false;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    bool isKnownCorpus = options.corpus.empty();
+    for (const char* name : Corpus::NAMES)
+        isKnownCorpus |= options.corpus == name;
+
+    return isKnownCorpus && options.size > 0 && options.size <= Format::MAXIMUM_BLOCK_SIZE && options.repeat > 0;
+}
+
+int main(int argc, char** argv) {
+
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "Usage : compressor_bench [--size BYTES] [--repeat N] [--corpus text|binary|runs|random] "
+                     "[--cpu scalar|sse4.2|avx2|avx512]\n";
+        return 1;
+    }
+
+    if (!CPU::force(options.cpuLevel)) {
+        std::cerr << "The CPU does not support " << CPU::name(options.cpuLevel) << "!\n";
+        return 1;
+    }
+    printf("SIMD kernels: %s\n", CPU::name(CPU::active()));
+
+    printf("%-8s %-20s %12s %14s\n", "Corpus", "Benchmark", "MB/s", "Bytes/Symbol");
+
+    bool isValid = true;
+    for (const char* name : Corpus::NAMES) {
+        if (options.corpus.empty() || options.corpus == name)
+            isValid = runCorpus(name, options) && isValid;
+    }
+
+    return isValid ? 0 : 1;
+}
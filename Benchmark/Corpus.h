@@ -0,0 +1,135 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Deterministic synthetic inputs for the benchmarks, generated locally so results are comparable offline <br>
+ * The same name and size always give the same bytes on every platform
+ */
+namespace Corpus {
+
+    // xorshift64*, used instead of the standard distributions whose output depends on the library
+    class Random {
+        uint64_t state;
+
+    public:
+        explicit Random(uint64_t seed) : state(seed ? seed : 1) {}
+
+        uint64_t next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 2685821657736338717ull;
+        }
+
+        // Uniform in [0, bound)
+        uint32_t below(uint32_t bound) {
+            return (uint32_t) ((next() >> 32) * bound >> 32);
+        }
+    };
+
+    // English like text, words follow a skewed distribution as in natural language
+    inline std::vector<uint8_t> text(size_t size) {
+        static const char* const words[] = {
+                "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+                "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+                "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+                "more", "when", "will", "would", "who", "so", "no", "compression", "block", "transform", "symbol",
+                "dictionary", "sorted", "suffix", "array", "index", "stream", "history", "language", "century"
+        };
+        const uint32_t numberOfWords = sizeof(words) / sizeof(words[0]);
+
+        Random random(1);
+        std::vector<uint8_t> output;
+        output.reserve(size + 16);
+
+        bool isSentenceStart = true;
+        while (output.size() < size) {
+            // Minimum of two draws favors the first (most common) words
+            uint32_t index = std::min(random.below(numberOfWords), random.below(numberOfWords));
+            std::string word = words[index];
+            if (isSentenceStart)
+                word[0] = (char) (word[0] - 'a' + 'A');
+            output.insert(output.end(), word.begin(), word.end());
+
+            uint32_t separator = random.below(100);
+            isSentenceStart = separator < 8;
+            if (separator < 2)
+                output.push_back('.'), output.push_back('\n');
+            else if (separator < 8)
+                output.push_back('.'), output.push_back(' ');
+            else if (separator < 14)
+                output.push_back(','), output.push_back(' ');
+            else
+                output.push_back(' ');
+        }
+
+        output.resize(size);
+        return output;
+    }
+
+    // Fixed size records of little endian counters, small floats and flags, as in tables and executables
+    inline std::vector<uint8_t> binary(size_t size) {
+        Random random(2);
+        std::vector<uint8_t> output;
+        output.reserve(size + 16);
+
+        for (uint32_t record = 0; output.size() < size; ++record) {
+            uint32_t fields[4] = {record, 1000 + random.below(64), 0x3F800000u + (random.below(256) << 12),
+                                  random.below(4) == 0 ? 0xFFFFFFFFu : 0};
+            for (uint32_t field : fields) {
+                for (int i = 0; i < 4; ++i)
+                    output.push_back((uint8_t) (field >> (8 * i)));
+            }
+        }
+
+        output.resize(size);
+        return output;
+    }
+
+    // Long runs of repeated bytes, as in images and sparse files
+    inline std::vector<uint8_t> runs(size_t size) {
+        Random random(3);
+        std::vector<uint8_t> output;
+        output.reserve(size);
+
+        while (output.size() < size) {
+            uint8_t value = (uint8_t) random.below(16);
+            size_t length = std::min((size_t) 1 + random.below(200), size - output.size());
+            output.insert(output.end(), length, value);
+        }
+
+        return output;
+    }
+
+    // Incompressible bytes, the worst case of every stage
+    inline std::vector<uint8_t> random(size_t size) {
+        Random random(4);
+        std::vector<uint8_t> output(size);
+        for (uint8_t& byte : output)
+            byte = (uint8_t) random.next();
+        return output;
+    }
+
+    const char* const NAMES[] = {"text", "binary", "runs", "random"};
+
+    // Empty if [name] is not one of NAMES
+    inline std::vector<uint8_t> generate(const std::string& name, size_t size) {
+        if (name == "text")
+            return text(size);
+        if (name == "binary")
+            return binary(size);
+        if (name == "runs")
+            return runs(size);
+        if (name == "random")
+            return random(size);
+        return std::vector<uint8_t>();
+    }
+
+}
+
+#endif //CORPUS_H
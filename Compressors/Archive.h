@@ -0,0 +1,528 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+#include "Compressor.h"
+#include "Format.h"
+#include "../Utils/BinaryIO.h"
+#include "../Utils/FileSystem.h"
+#include "../Utils/ThreadPool.h"
+
+/**
+ * Many files (and directories) compressed into a single archive <br>
+ * The files are concatenated and the result is split in blocks as in Format.h,
+ * so small files share blocks and big ones span several of them.
+ * The blocks are compressed and extracted concurrently, on a pool of worker threads
+ *
+ * @Archive_Format
+ * ___________________________________________________
+ * |             Magic Number "CMPA" (4 Bytes)       |
+ * |                 Version (1 Byte)                |
+ * |            Block Size (4 Bytes, LE)             |
+ * |_________________________________________________|
+ * |  Blocks of the concatenated files (Format.h)    |
+ * |_________________________________________________|
+ * |  Index of the blocks (Format.h)                 |
+ * |_________________________________________________|
+ * |  Entries, Number of Entries (Varint) then:      |
+ * |   - Path Length (Varint) and Path ('/' separated)
+ * |     ending with a '/' for an empty directory    |
+ * |   - File Size (Varint, 0 for a directory)       |
+ * |_________________________________________________|
+ * |  Footer:                                        |
+ * |   - Data Size (8 Bytes, LE)                     |
+ * |   - Index Offset (8 Bytes, LE)                  |
+ * |   - Number of Blocks (4 Bytes, LE)              |
+ * |   - Entries Size (8 Bytes, LE)                  |
+ * |   - Magic Number "CMPA" (4 Bytes)               |
+ * ---------------------------------------------------
+ *
+ * Each file starts in the concatenation where the previous one ends, in the order of the entries.
+ * The other directories are not stored, they are created with the files under them
+ */
+namespace Archive {
+
+    const uint8_t MAGIC[4] = {'C', 'M', 'P', 'A'};
+    const uint8_t VERSION = 3;
+
+    const size_t HEADER_SIZE = sizeof(MAGIC) + 1 + 4;
+    const size_t FOOTER_SIZE = 8 + 8 + 4 + 8 + sizeof(MAGIC);
+
+    struct Entry {
+        std::string path; // inside the archive
+        uint64_t size;
+        uint64_t offset; // in the concatenation of all the files
+        std::string source; // file it is read from when creating the archive
+        bool isDirectory; // only the empty ones are stored
+    };
+
+    struct Footer {
+        Format::Footer blocks;
+        uint64_t entriesSize;
+    };
+
+    /**
+     * Everything but the blocks themselves
+     */
+    struct Contents {
+        uint32_t blockSize;
+        Footer footer;
+        std::vector<Format::BlockEntry> blocks;
+        std::vector<Entry> entries;
+    };
+
+    inline bool hasMagic(const uint8_t* input, size_t length) {
+        return length >= sizeof(MAGIC) && memcmp(input, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    // Relative, without "." or ".." components, so extracting can not write outside the output directory
+    inline bool isSafePath(const std::string& path) {
+        if (path.empty() || path.find_first_of("\\:") != std::string::npos)
+            return false;
+
+        size_t start = 0;
+        while (true) {
+            size_t end = path.find('/', start);
+            std::string component = path.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            if (component.empty() || component == "." || component == "..")
+                return false;
+            if (end == std::string::npos)
+                return true;
+            start = end + 1;
+        }
+    }
+
+    // Adds the file [source], or all the files under it if it is a directory
+    inline bool addEntries(const std::string& source, const std::string& path, std::vector<Entry>& entries) {
+        if (FileSystem::isDirectory(source)) {
+            std::vector<std::string> names;
+            if (!FileSystem::listDirectory(source, names))
+                return false;
+
+            for (const std::string& name : names) {
+                if (!addEntries(source + "/" + name, path.empty() ? name : path + "/" + name, entries))
+                    return false;
+            }
+
+            // The current directory itself has no path
+            if (names.empty() && !path.empty()) {
+                if (!isSafePath(path))
+                    return false;
+                entries.push_back({path, 0, 0, source, true});
+            }
+            return true;
+        }
+
+        int64_t size = BinaryIO::getFileSize(source);
+        if (size < 0 || !isSafePath(path))
+            return false;
+
+        entries.push_back({path, (uint64_t) size, 0, source, false});
+        return true;
+    }
+
+    /**
+     * Lists the files and the empty directories of [inputs] and places the files one after the other <br>
+     * Files are stored under the name of the input, the content of "." is stored without prefix <br>
+     * Returns false if an input can not be read or two files would have the same path
+     */
+    inline bool collectEntries(const std::vector<std::string>& inputs, std::vector<Entry>& entries) {
+        entries.clear();
+        for (const std::string& input : inputs) {
+            std::string name = FileSystem::baseName(input);
+            bool isCurrentDirectory = name == "." || name == ".." || name == "/";
+            if (!addEntries(input, isCurrentDirectory ? "" : name, entries))
+                return false;
+        }
+
+        std::set<std::string> paths;
+        uint64_t offset = 0;
+        for (Entry& entry : entries) {
+            if (!paths.insert(entry.path).second)
+                return false;
+
+            entry.offset = offset;
+            offset += entry.size;
+        }
+        return true;
+    }
+
+    inline std::vector<uint8_t> writeEntries(const std::vector<Entry>& entries) {
+        std::vector<uint8_t> output;
+        uint8_t varint[BinaryIO::MAXIMUM_VARINT_SIZE];
+
+        output.insert(output.end(), varint, varint + BinaryIO::storeVarint(varint, entries.size()));
+        for (const Entry& entry : entries) {
+            std::string path = entry.isDirectory ? entry.path + "/" : entry.path;
+            output.insert(output.end(), varint, varint + BinaryIO::storeVarint(varint, path.size()));
+            output.insert(output.end(), path.begin(), path.end());
+            output.insert(output.end(), varint, varint + BinaryIO::storeVarint(varint, entry.size));
+        }
+        return output;
+    }
+
+    // Returns false if the entries are corrupted, unsafe or their sizes do not add up to [dataSize]
+    inline bool readEntries(const uint8_t* input, size_t length, uint64_t dataSize, std::vector<Entry>& entries) {
+        const uint8_t* end = input + length;
+        uint64_t numberOfEntries;
+        if (!BinaryIO::loadVarint(input, end, numberOfEntries) || numberOfEntries > length)
+            return false;
+
+        entries.resize(numberOfEntries);
+        uint64_t offset = 0;
+        for (Entry& entry : entries) {
+            uint64_t pathLength;
+            if (!BinaryIO::loadVarint(input, end, pathLength) || pathLength > (uint64_t) (end - input))
+                return false;
+
+            entry.path.assign((const char*) input, pathLength);
+            input += pathLength;
+            entry.isDirectory = !entry.path.empty() && entry.path.back() == '/';
+            if (entry.isDirectory)
+                entry.path.pop_back();
+
+            if (!BinaryIO::loadVarint(input, end, entry.size) || entry.size > dataSize - offset ||
+                !isSafePath(entry.path) || (entry.isDirectory && entry.size != 0))
+                return false;
+
+            entry.offset = offset;
+            offset += entry.size;
+        }
+
+        return input == end && offset == dataSize;
+    }
+
+    inline void writeHeader(uint8_t* output, uint32_t blockSize) {
+        memcpy(output, MAGIC, sizeof(MAGIC));
+        output[sizeof(MAGIC)] = VERSION;
+        BinaryIO::storeUint32(output + sizeof(MAGIC) + 1, blockSize);
+    }
+
+    inline void writeFooter(uint8_t* output, const Footer& footer) {
+        BinaryIO::storeUint64(output, footer.blocks.dataSize);
+        BinaryIO::storeUint64(output + 8, footer.blocks.indexOffset);
+        BinaryIO::storeUint32(output + 16, footer.blocks.numberOfBlocks);
+        BinaryIO::storeUint64(output + 20, footer.entriesSize);
+        memcpy(output + 28, MAGIC, sizeof(MAGIC));
+    }
+
+    /**
+     * Reads the header, the index and the entries of an archive <br>
+     * Returns false if it is not an archive or it is corrupted
+     */
+    inline bool readContents(std::ifstream& input, Contents& contents) {
+        uint64_t fileSize = BinaryIO::getFileSize(input);
+
+        uint8_t header[HEADER_SIZE];
+        uint8_t footer[FOOTER_SIZE];
+        if (fileSize < HEADER_SIZE + FOOTER_SIZE || !BinaryIO::read(input, 0, header, sizeof(header)) ||
+            !hasMagic(header, sizeof(header)) || header[sizeof(MAGIC)] != VERSION)
+            return false;
+        if (!BinaryIO::read(input, fileSize - FOOTER_SIZE, footer, sizeof(footer)) ||
+            !hasMagic(footer + 28, sizeof(MAGIC)))
+            return false;
+
+        contents.blockSize = BinaryIO::loadUint32(header + sizeof(MAGIC) + 1);
+        contents.footer.blocks.dataSize = BinaryIO::loadUint64(footer);
+        contents.footer.blocks.indexOffset = BinaryIO::loadUint64(footer + 8);
+        contents.footer.blocks.numberOfBlocks = BinaryIO::loadUint32(footer + 16);
+        contents.footer.entriesSize = BinaryIO::loadUint64(footer + 20);
+        if (contents.blockSize < Format::MINIMUM_BLOCK_SIZE || contents.blockSize > Format::MAXIMUM_BLOCK_SIZE)
+            return false;
+
+        // The index and the entries fill the space between the blocks and the footer
+        const Format::Footer& blocksFooter = contents.footer.blocks;
+        uint64_t indexSize = Format::indexSize(blocksFooter.numberOfBlocks);
+        if (blocksFooter.indexOffset < HEADER_SIZE || blocksFooter.indexOffset > fileSize - FOOTER_SIZE ||
+            fileSize - FOOTER_SIZE - blocksFooter.indexOffset < indexSize ||
+            fileSize - FOOTER_SIZE - blocksFooter.indexOffset - indexSize != contents.footer.entriesSize)
+            return false;
+
+        std::vector<uint8_t> indexAndEntries(indexSize + contents.footer.entriesSize);
+        if (!BinaryIO::read(input, blocksFooter.indexOffset, indexAndEntries.data(), indexAndEntries.size()))
+            return false;
+
+        return Format::readIndex(indexAndEntries.data(), blocksFooter, contents.blockSize, contents.blocks, HEADER_SIZE) &&
+               readEntries(indexAndEntries.data() + indexSize, contents.footer.entriesSize, blocksFooter.dataSize,
+                           contents.entries);
+    }
+
+    // Index of the first entry ending after [offset], entries are sorted by offset
+    inline size_t findEntry(const std::vector<Entry>& entries, uint64_t offset) {
+        size_t first = 0, last = entries.size();
+        while (first < last) {
+            size_t middle = first + (last - first) / 2;
+            if (entries[middle].offset + entries[middle].size <= offset)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first;
+    }
+
+    // Reads the bytes [offset, offset + length) of the concatenation of the files to [output]
+    inline bool readData(const std::vector<Entry>& entries, uint64_t offset, uint64_t length, uint8_t* output) {
+        for (size_t i = findEntry(entries, offset); i < entries.size() && entries[i].offset < offset + length; ++i) {
+            const Entry& entry = entries[i];
+            uint64_t begin = std::max(offset, entry.offset);
+            uint64_t end = std::min(offset + length, entry.offset + entry.size);
+            if (begin >= end)
+                continue;
+
+            std::ifstream input(entry.source, std::ios::in | std::ios::binary);
+            if (!BinaryIO::read(input, begin - entry.offset, output + (begin - offset), end - begin))
+                return false;
+        }
+        return true;
+    }
+
+    // Writes the bytes [offset, offset + length) of the concatenation to the files under [directory], which already exist
+    inline bool writeData(const std::vector<Entry>& entries, const std::string& directory, uint64_t offset,
+                          uint64_t length, const uint8_t* data) {
+        for (size_t i = findEntry(entries, offset); i < entries.size() && entries[i].offset < offset + length; ++i) {
+            const Entry& entry = entries[i];
+            uint64_t begin = std::max(offset, entry.offset);
+            uint64_t end = std::min(offset + length, entry.offset + entry.size);
+            if (begin >= end)
+                continue;
+
+            // Other blocks of the same file are written concurrently, each one through its own stream
+            std::fstream output(directory + "/" + entry.path, std::ios::in | std::ios::out | std::ios::binary);
+            output.seekp(begin - entry.offset);
+            output.write((const char*) data + (begin - offset), end - begin);
+            if (!output.good())
+                return false;
+        }
+        return true;
+    }
+
+    // Runs on a worker thread, returns an empty buffer if the block can not be read
+    inline std::vector<uint8_t> compressBlock(const std::vector<Entry>& entries, uint64_t offset, uint32_t length,
+                                              const Compressor::Options& options) {
+        std::vector<uint8_t> block(length);
+        if (!readData(entries, offset, length, block.data()))
+            return std::vector<uint8_t>();
+
+        Compressor::Context& context = Compressor::Context::forCurrentThread();
+        std::vector<uint8_t> compressed(Compressor::compressBlockBound(length, options.dictionary, options.searchIndex));
+        size_t compressedSize = Compressor::compressBlock(block.data(), length, compressed.data(), compressed.size(),
+                                                          options, context);
+        // Each worker reuses its context for all its blocks (ThreadPool.h), so the next one finds the memory allocated
+        context.arena.reset();
+
+        compressed.resize(Compressor::isError(compressedSize) ? 0 : compressedSize);
+        return compressed;
+    }
+
+    // Runs on a worker thread, each one reads the archive through its own stream. Nothing is written if [directory] is null
+    inline bool extractBlock(const std::string& archiveFilename, const Contents& contents,
+                             const Format::BlockEntry& block, const std::string* directory) {
+        std::ifstream input(archiveFilename, std::ios::in | std::ios::binary);
+        std::vector<uint8_t> compressed(block.compressedSize);
+        if (!BinaryIO::read(input, block.compressedOffset, compressed.data(), compressed.size()))
+            return false;
+
+        Compressor::Context& context = Compressor::Context::forCurrentThread();
+        std::vector<uint8_t> decompressed(block.originalSize);
+        bool isValid = Compressor::decompressBlock(compressed.data(), compressed.size(), decompressed.data(),
+                                                   block.originalSize, context);
+        context.arena.reset();
+
+        return isValid && (directory == nullptr || writeData(contents.entries, *directory, block.originalOffset,
+                                                             block.originalSize, decompressed.data()));
+    }
+
+    // Extracts the blocks concurrently to the files under [directory] (or only checks them if it is null)
+    inline bool extractBlocks(const std::string& archiveFilename, const Contents& contents, const std::string* directory,
+                              size_t numberOfThreads) {
+        ThreadPool pool(numberOfThreads);
+        std::vector<std::future<bool>> results;
+        for (const Format::BlockEntry& block : contents.blocks) {
+            results.push_back(pool.submit([&archiveFilename, &contents, &block, directory]() {
+                return extractBlock(archiveFilename, contents, block, directory);
+            }));
+        }
+
+        bool isValid = true;
+        for (std::future<bool>& result : results)
+            isValid = result.get() && isValid;
+        return isValid;
+    }
+
+    /**
+     * Compresses the files and directories of [inputs] to a new archive, on [numberOfThreads] workers <br>
+     * Long range matching, dictionaries and chunk caches are not applied, the other options are <br>
+     * Returns false if an input can not be read
+     */
+    inline bool create(const std::string& archiveFilename, const std::vector<std::string>& inputs,
+                       const Compressor::Options& options = Compressor::Options(),
+                       size_t numberOfThreads = ThreadPool::defaultNumberOfThreads()) {
+
+        uint32_t blockSize = options.blockSize;
+        if (blockSize < Format::MINIMUM_BLOCK_SIZE || blockSize > Format::MAXIMUM_BLOCK_SIZE)
+            return false;
+
+        // The header of the archive has no dictionary ID, and its blocks all have the block size
+        Compressor::Options blockOptions = options;
+        blockOptions.dictionary = nullptr;
+        blockOptions.chunkCache = nullptr;
+
+        std::vector<Entry> entries;
+        if (!collectEntries(inputs, entries))
+            return false;
+        uint64_t dataSize = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+
+        remove(archiveFilename.c_str()); // Remove Output File If Exists
+        std::ofstream output(archiveFilename, std::ios::out | std::ios::binary);
+
+        uint8_t header[HEADER_SIZE];
+        writeHeader(header, blockSize);
+        output.write((const char*) header, sizeof(header));
+        uint64_t compressedSize = HEADER_SIZE;
+
+        // Blocks are written in order as they complete, a few of them ahead are compressed meanwhile
+        ThreadPool pool(numberOfThreads);
+        std::deque<std::future<std::vector<uint8_t>>> pending;
+        std::vector<Format::BlockEntry> blocks;
+
+        auto writeNextBlock = [&]() {
+            std::vector<uint8_t> compressed = pending.front().get();
+            pending.pop_front();
+            if (compressed.empty())
+                return false;
+
+            uint64_t offset = (uint64_t) blocks.size() * blockSize;
+            uint32_t originalSize = std::min(dataSize - offset, (uint64_t) blockSize);
+            blocks.push_back({offset, compressedSize, originalSize, (uint32_t) compressed.size()});
+
+            output.write((const char*) compressed.data(), compressed.size());
+            compressedSize += compressed.size();
+            return true;
+        };
+
+        for (uint64_t offset = 0; offset < dataSize; offset += blockSize) {
+            uint32_t length = std::min(dataSize - offset, (uint64_t) blockSize);
+            pending.push_back(pool.submit([&entries, &blockOptions, offset, length]() {
+                return compressBlock(entries, offset, length, blockOptions);
+            }));
+
+            if (pending.size() > 2 * pool.size() && !writeNextBlock())
+                return false;
+        }
+        while (!pending.empty()) {
+            if (!writeNextBlock())
+                return false;
+        }
+
+        Footer footer = {{dataSize, compressedSize, (uint32_t) blocks.size()}, 0};
+        std::vector<uint8_t> index(Format::indexSize(footer.blocks.numberOfBlocks));
+        Format::writeIndex(index.data(), blocks);
+        std::vector<uint8_t> entriesData = writeEntries(entries);
+        footer.entriesSize = entriesData.size();
+
+        uint8_t footerData[FOOTER_SIZE];
+        writeFooter(footerData, footer);
+        output.write((const char*) index.data(), index.size());
+        output.write((const char*) entriesData.data(), entriesData.size());
+        output.write((const char*) footerData, sizeof(footerData));
+
+        return output.good();
+    }
+
+    /**
+     * Reads the entries of an archive without decompressing anything <br>
+     * Returns false if it is not an archive or it is corrupted
+     */
+    inline bool list(const std::string& archiveFilename, std::vector<Entry>& entries) {
+        std::ifstream input(archiveFilename, std::ios::in | std::ios::binary);
+        Contents contents;
+        if (!readContents(input, contents))
+            return false;
+
+        entries = std::move(contents.entries);
+        return true;
+    }
+
+    /**
+     * Extracts all the files of an archive under [directory], decompressing its blocks on [numberOfThreads] workers <br>
+     * Returns false if it is not an archive, it is corrupted or a file can not be written
+     */
+    inline bool extract(const std::string& archiveFilename, const std::string& directory,
+                        size_t numberOfThreads = ThreadPool::defaultNumberOfThreads()) {
+
+        std::ifstream input(archiveFilename, std::ios::in | std::ios::binary);
+        Contents contents;
+        if (!readContents(input, contents))
+            return false;
+
+        // All files are created first, so the blocks can fill them in any order
+        for (const Entry& entry : contents.entries) {
+            std::string path = directory + "/" + entry.path;
+            if (!FileSystem::createDirectories(entry.isDirectory ? path : FileSystem::parentPath(path)))
+                return false;
+            if (entry.isDirectory)
+                continue;
+
+            std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!output.good())
+                return false;
+        }
+
+        return extractBlocks(archiveFilename, contents, &directory, numberOfThreads);
+    }
+
+    /**
+     * Decompresses all the blocks of an archive on [numberOfThreads] workers and checks their checksums, nothing is written <br>
+     * Returns false if it is not an archive or it is corrupted
+     */
+    inline bool test(const std::string& archiveFilename, size_t numberOfThreads = ThreadPool::defaultNumberOfThreads()) {
+        std::ifstream input(archiveFilename, std::ios::in | std::ios::binary);
+        Contents contents;
+        return readContents(input, contents) && extractBlocks(archiveFilename, contents, nullptr, numberOfThreads);
+    }
+
+    struct Match {
+        std::string path;
+        uint64_t offset; // of the pattern in the file
+        std::string context;
+    };
+
+    /**
+     * Finds the occurrences of [pattern] in the files of an archive, as Compressor::searchBlocks does <br>
+     * The matches spanning two files are skipped, and their context is cut at the ends of their file <br>
+     * Returns false if the pattern is not valid, it is not an archive or it is corrupted
+     */
+    inline bool search(const std::string& archiveFilename, const std::string& pattern, size_t contextSize,
+                       std::vector<Match>& matches,
+                       Compressor::Context& context = Compressor::Context::forCurrentThread()) {
+        std::ifstream input(archiveFilename, std::ios::in | std::ios::binary);
+        Contents contents;
+        std::vector<Compressor::Match> found;
+        if (!readContents(input, contents) ||
+            !Compressor::searchBlocks(input, contents.blocks, nullptr, pattern, contextSize, found, context))
+            return false;
+
+        for (const Compressor::Match& match : found) {
+            const Entry& entry = contents.entries[findEntry(contents.entries, match.offset)];
+            if (match.offset + pattern.size() > entry.offset + entry.size)
+                continue;
+
+            uint64_t begin = std::max(match.contextOffset, entry.offset);
+            uint64_t end = std::min(match.contextOffset + match.context.size(), entry.offset + entry.size);
+            matches.push_back({entry.path, match.offset - entry.offset,
+                               match.context.substr(begin - match.contextOffset, end - begin)});
+        }
+        return true;
+    }
+
+}
+
+#endif //ARCHIVE_H
@@ -3,9 +3,8 @@
 
 #include "../../Utils/BinaryIO.h"
 #include "SuffixArray.h"
-#include <algorithm>
 #include <cstdint>
-#include <deque>
+#include "../../Utils/ScratchArena.h"
 #include <bit_string.h>
 
 /**
@@ -13,111 +12,186 @@
  */
 class BWT {
 
-    static uint32_t originalIndex;
-
 public:
 
+    /**
+     * Encoding context, owns the scratch memory of the suffix array so consecutive blocks reuse it <br>
+     * Independent encoders can run concurrently, a single one must not be shared between threads
+     */
+    class Encoder {
+        ScratchArena ownArena;
+        ScratchArena& arena;
+
+    public:
+        Encoder() : arena(ownArena) {}
+
+        // Uses the memory of a bigger pipeline instead of its own
+        explicit Encoder(ScratchArena& sharedArena) : arena(sharedArena) {}
+
+        uint32_t encode(const uint8_t* input, uint32_t length, uint8_t* bwt) {
+            return BWT::encode(input, length, bwt, arena);
+        }
+
+        uint32_t encode(const uint8_t* input, uint32_t length, const uint32_t* suffixArray, uint8_t* bwt) {
+            return BWT::encode(input, length, suffixArray, bwt);
+        }
+    };
+
+    /**
+     * Decoding context, owns the scratch memory of the left shift so consecutive blocks reuse it <br>
+     * Independent decoders can run concurrently, a single one must not be shared between threads
+     */
+    class Decoder {
+        ScratchArena ownArena;
+        ScratchArena& arena;
+
+    public:
+        Decoder() : arena(ownArena) {}
+
+        // Uses the memory of a bigger pipeline instead of its own
+        explicit Decoder(ScratchArena& sharedArena) : arena(sharedArena) {}
+
+        bool decode(const uint8_t* bwt, uint32_t length, uint32_t originalIndex, uint8_t* output) {
+            return BWT::decode(bwt, length, originalIndex, output, arena);
+        }
+    };
+
+    /**
+     * Writes the transform of [input] followed by a '\0' sentinel to [bwt], which must have room for length + 1 chars <br>
+     * Returns the original index, which is needed for decoding
+     */
+    static uint32_t encode(const uint8_t* input, uint32_t length, uint8_t* bwt,
+                           ScratchArena& arena = ScratchArena::forCurrentThread()) {
+
+        ScratchArena::Scope scope(arena);
+
+        uint32_t* suffixArray = arena.allocate<uint32_t>(length);
+        SuffixArray::buildSuffixArray(input, length, suffixArray, arena);
+
+        return generateBWT(input, length, suffixArray, bwt);
+    }
+
+    /**
+     * Same as encode, using the suffix array of [input] which was already built
+     */
+    static uint32_t encode(const uint8_t* input, uint32_t length, const uint32_t* suffixArray, uint8_t* bwt) {
+        return generateBWT(input, length, suffixArray, bwt);
+    }
+
+    /**
+     * Writes the original text of [bwt] to [output], which must have room for length - 1 chars <br>
+     * Returns false if the original index is not valid
+     */
+    static bool decode(const uint8_t* bwt, uint32_t length, uint32_t originalIndex, uint8_t* output,
+                       ScratchArena& arena = ScratchArena::forCurrentThread()) {
+
+        if (originalIndex >= length)
+            return false;
+
+        invertBWT(bwt, length, originalIndex, output, arena);
+        return true;
+    }
+
     static void encode(const std::string& filename, const std::string& outputFileName) {
 
-        std::string toBeEncoded = BinaryIO::readString(filename);
-        toBeEncoded += '\0'; // Last char must be the smallest of all
+        ScratchArena& arena = ScratchArena::forCurrentThread();
+        ScratchArena::Scope scope(arena);
 
-        std::vector<uint32_t> suffixArray = SuffixArray::buildSuffixArray(toBeEncoded);
+        std::string toBeEncoded = BinaryIO::readString(filename);
+        uint32_t length = toBeEncoded.length();
 
-        std::string bwt = generateBWT(toBeEncoded, suffixArray);
+        uint8_t* bwt = arena.allocate<uint8_t>(length + 1);
+        uint32_t originalIndex = encode((const uint8_t*) toBeEncoded.data(), length, bwt, arena);
 
         remove(outputFileName.c_str()); // Remove Output File If Exists
         BinaryIO::write(outputFileName, bit_string::from_uint_32(originalIndex));
-        BinaryIO::write(outputFileName, bwt);
+        BinaryIO::write(outputFileName, bwt, length + 1);
 
     }
 
     static void decode(const std::string& filename, const std::string& outputFileName) {
 
+        ScratchArena& arena = ScratchArena::forCurrentThread();
+        ScratchArena::Scope scope(arena);
+
         // Original Index is the first 4 bytes of the file
-        originalIndex = BinaryIO::readBitString(filename, 0, sizeof(originalIndex)).to_uint_32();
+        uint32_t originalIndex = BinaryIO::readBitString(filename, 0, sizeof(originalIndex)).to_uint_32();
         std::string bwt = BinaryIO::readString(filename, sizeof(originalIndex));
 
-        std::string inverseBWT = BWT::invertBWT(bwt, originalIndex);
-        inverseBWT.pop_back(); // remove '\0' which was added at encoding
+        // The '\0' which was added at encoding is not written
+        uint8_t* inverseBWT = arena.allocate<uint8_t>(bwt.length());
+        bool isValid = decode((const uint8_t*) bwt.data(), bwt.length(), originalIndex, inverseBWT, arena);
 
         remove(outputFileName.c_str()); // Remove Output File If Exists
-        BinaryIO::write(outputFileName, inverseBWT);
+        if (isValid)
+            BinaryIO::write(outputFileName, inverseBWT, bwt.length() - 1);
 
     }
 
 
 private:
 
-    static std::vector<uint32_t> computeLeftShift(const std::string& bwt) {
+    // Maps each row of the sorted rotations to the row of its rotation shifted left by one char
+    // The sentinel at [originalIndex] is the smallest char, so it is always the first row
+    static void computeLeftShift(const uint8_t* bwt, uint32_t length, uint32_t originalIndex, uint32_t* leftShift) {
 
-        // Each element is a list of all indices the this element appeared at in bwt
-        // example: symbolsIndicesList[65] contains all indices that letter 'A' appears at
-        std::deque<uint32_t> symbolsIndicesList[256]; // 256 is the length all symbols as we us byte it is 256 maximum
-        for (int i = 0; i < bwt.length(); i++) {
-            symbolsIndicesList[(uint8_t) bwt[i]].push_back(i);
+        // Row at which the first rotation starting with each symbol is, after the sentinel row
+        uint32_t firstRow[256] = {0};
+        for (uint32_t i = 0; i < length; i++) {
+            if (i != originalIndex)
+                firstRow[bwt[i]]++;
         }
 
-        std::string sortedBWT = bwt;
-        std::sort(sortedBWT.begin(), sortedBWT.end(), unsignedCharsCompare);
-
-        std::vector<uint32_t> leftShift(bwt.length());
-        // Computes Left Shift
-        for (int i = 0; i < bwt.length(); i++) {
-            std::deque<uint32_t>& symbolIndices = symbolsIndicesList[(uint8_t) sortedBWT[i]];
-            leftShift[i] = symbolIndices.front();
-            symbolIndices.pop_front();
+        for (uint32_t symbol = 0, sum = 1; symbol < 256; symbol++) {
+            uint32_t count = firstRow[symbol];
+            firstRow[symbol] = sum;
+            sum += count;
         }
 
-        return leftShift;
+        // Computes Left Shift, symbols keep their relative order between the first and the last column
+        leftShift[0] = originalIndex;
+        for (uint32_t i = 0; i < length; i++) {
+            if (i != originalIndex)
+                leftShift[firstRow[bwt[i]]++] = i;
+        }
     }
 
-    // Generate Burrows - Wheeler Transform of given text
-    static std::string generateBWT(const std::string& input, std::vector<uint32_t>& suffixArray) {
+    // Generate Burrows - Wheeler Transform of given text terminated by a '\0' sentinel
+    // [bwtLastColumn] must have room for length + 1 chars, returns the row of the original text
+    static uint32_t generateBWT(const uint8_t* input, uint32_t length, const uint32_t* suffixArray, uint8_t* bwtLastColumn) {
+
+        // The sentinel alone is the smallest rotation, which is preceded by the last char
+        bwtLastColumn[0] = length > 0 ? input[length - 1] : '\0';
+        uint32_t originalIndex = 0;
+
         // Iterates over the suffix array to find
         // the last char of each cyclic rotation
-        std::string bwtLastColumn;
-
-        int n = input.length();
-        for (int i = 0; i < suffixArray.size(); ++i) {
-            // Computes the last char which is given by
-            // input[(suffix + n - 1) % n]
-            int j = suffixArray[i] - 1;
-            if (j < 0) {
-                j += n;
+        for (uint32_t i = 0; i < length; ++i) {
+            if (suffixArray[i] == 0) {
+                originalIndex = i + 1;
+                bwtLastColumn[i + 1] = '\0'; // the sentinel precedes the whole input
+            } else {
+                bwtLastColumn[i + 1] = input[suffixArray[i] - 1];
             }
-
-            if (suffixArray[i] == 0)
-                originalIndex = i;
-
-            bwtLastColumn += input[j];
         }
 
-        return bwtLastColumn;
+        return originalIndex;
     }
 
-    static bool unsignedCharsCompare(const char c1, const char c2) {
-        return (unsigned char) c1 < (unsigned char) c2;
-    }
+    // [inverseBWT] must have room for length - 1 chars, the sentinel is not written
+    static void invertBWT(const uint8_t* bwt, uint32_t length, uint32_t index, uint8_t* inverseBWT, ScratchArena& arena) {
 
-    static std::string invertBWT(const std::string& BWT, long long index) {
-
-        std::vector<uint32_t> leftShift = computeLeftShift(BWT);
-
-        std::string inverseBWT;
-        inverseBWT.reserve(BWT.length());
+        ScratchArena::Scope scope(arena);
+        uint32_t* leftShift = arena.allocate<uint32_t>(length);
+        computeLeftShift(bwt, length, index, leftShift);
 
         // Decodes the bwt
-        for (int i = 0; i < BWT.length(); i++) {
+        for (uint32_t i = 0; i + 1 < length; i++) {
             index = leftShift[index];
-            inverseBWT += BWT[index];
+            inverseBWT[i] = bwt[index];
         }
-
-        return inverseBWT;
     }
 
 };
 
-uint32_t BWT::originalIndex = 0;
-
 #endif //BWT_H
@@ -2,9 +2,8 @@
 #define SUFFIX_ARRAY_H
 
 #include <algorithm>
-#include <vector>
-#include <string>
 #include <cstdint>
+#include "../../Utils/ScratchArena.h"
 
 
 /**
@@ -17,30 +16,37 @@ class SuffixArray {
 
 public:
 
-    static std::vector<uint32_t> buildSuffixArray(const std::string& inputString) {
-        const int ADDITIONAL_SIZE = 3;
-        std::vector<uint32_t> suffixArray(inputString.size() + ADDITIONAL_SIZE);
+    /**
+     * Fills [suffixArray] (of size [length]) with the sorted suffixes of [input] <br>
+     * The end of the input acts as a unique sentinel smaller than every byte (including zero) <br>
+     * All temporary buffers are taken from [arena] and released before returning
+     */
+    static void buildSuffixArray(const uint8_t* input, uint32_t length, uint32_t* suffixArray,
+                                 ScratchArena& arena = ScratchArena::forCurrentThread()) {
+
+        // The Algorithm requires at least 2 characters
+        if (length < 2) {
+            if (length == 1)
+                suffixArray[0] = 0;
+            return;
+        }
 
-        std::vector<int> input;
-        input.reserve(suffixArray.size());
+        ScratchArena::Scope scope(arena);
 
-        for (uint8_t c : inputString) {
-            input.push_back(c);
-        }
+        const int ADDITIONAL_SIZE = 3;
+        int* T = arena.allocate<int>(length + ADDITIONAL_SIZE);
 
-        // The Algorithm requires tha the last 3 elements are zeros
-        for (int i = 0; i < ADDITIONAL_SIZE; ++i) {
-            input.push_back(0);
+        // The Algorithm requires the alphabet to be {1..K}, zero is reserved for the end of the string
+        for (uint32_t i = 0; i < length; ++i) {
+            T[i] = input[i] + 1;
         }
 
-        buildSuffixArray(input.data(), (int*) suffixArray.data(), inputString.size(), 256);
-
-        // Remove the 3 additional added zeros
+        // The Algorithm requires tha the last 3 elements are zeros
         for (int i = 0; i < ADDITIONAL_SIZE; ++i) {
-            suffixArray.pop_back();
+            T[length + i] = 0;
         }
 
-        return suffixArray;
+        buildSuffixArray(T, (int*) suffixArray, length, 256, arena);
     }
 
 private:
@@ -56,8 +62,10 @@ private:
     }
 
     // Stably sort a[0..n-1] to b[0..n-1] with keys in 0..k from r
-    static void radixSort(const int a[], int b[], const int r[], int n, int k) { // count occurrences
-        std::vector<int> counterArray(k + 1, 0); // counter array
+    static void radixSort(const int a[], int b[], const int r[], int n, int k, ScratchArena& arena) {
+        ScratchArena::Scope scope(arena);
+        int* counterArray = arena.allocate<int>(k + 1);
+        std::fill(counterArray, counterArray + k + 1, 0);
 
         // count occurrences
         for (int i = 0; i < n; i++) {
@@ -79,18 +87,19 @@ private:
 
     // Find the suffix array of T[0..n-1] in {1..K}^n
     // Require T[n]=T[n+1]=T[n+2]=0, n>=2
-    static void buildSuffixArray(const int T[], int suffixArray[], int n, int K) {
+    static void buildSuffixArray(const int T[], int suffixArray[], int n, int K, ScratchArena& arena) {
+        ScratchArena::Scope scope(arena); // releases R, SA12, R0 and SA0 of this recursion level
         int n0 = (n + 2) / 3;
         int n1 = (n + 1) / 3;
         int n2 = n / 3;
         int n02 = n0 + n2;
 
-        int* R = new int[n02 + 3];
+        int* R = arena.allocate<int>(n02 + 3);
         R[n02] = R[n02 + 1] = R[n02 + 2] = 0;
-        int* SA12 = new int[n02 + 3];
+        int* SA12 = arena.allocate<int>(n02 + 3);
         SA12[n02] = SA12[n02 + 1] = SA12[n02 + 2] = 0;
-        int* R0 = new int[n0];
-        int* SA0 = new int[n0];
+        int* R0 = arena.allocate<int>(n0);
+        int* SA0 = arena.allocate<int>(n0);
 
         /*---------------------------------------- Step 0: Construct sample ----------------------------------------*/
         // Generate positions of mod 1 and mod 2 suffixes
@@ -101,9 +110,9 @@ private:
 
         /*-------------------------------------- Step 1: Sort sample suffixes --------------------------------------*/
         // LSB radix sort the mod 1 and mod 2 triples
-        radixSort(R, SA12, T + 2, n02, K);
-        radixSort(SA12, R, T + 1, n02, K);
-        radixSort(R, SA12, T, n02, K);
+        radixSort(R, SA12, T + 2, n02, K, arena);
+        radixSort(SA12, R, T + 1, n02, K, arena);
+        radixSort(R, SA12, T, n02, K, arena);
         // Find lexicographic names of triples and
         // Write them to correct places in R
         int name = 0, c0 = -1, c1 = -1, c2 = -1;
@@ -123,7 +132,7 @@ private:
         }
         // recurse if names are not yet unique
         if (name < n02) {
-            buildSuffixArray(R, SA12, n02, name);
+            buildSuffixArray(R, SA12, n02, name, arena);
             // store unique names in R using the suffix array
             for (int i = 0; i < n02; i++)
                 R[SA12[i]] = i + 1;
@@ -136,7 +145,7 @@ private:
         for (int i = 0, j = 0; i < n02; i++)
             if (SA12[i] < n0)
                 R0[j++] = 3 * SA12[i];
-        radixSort(R0, SA0, T, n0, K);
+        radixSort(R0, SA0, T, n0, K, arena);
 
         /*---------------------------------------------- Step 3: Merge ---------------------------------------------*/
         // merge sorted SA0 suffixes and sorted SA12 suffixes
@@ -162,11 +171,6 @@ private:
             }
         }
         #undef GetI
-
-        delete[] R;
-        delete[] SA12;
-        delete[] SA0;
-        delete[] R0;
     }
 
 };
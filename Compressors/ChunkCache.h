@@ -0,0 +1,138 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../Utils/BinaryIO.h"
+#include "../Utils/CRC32C.h"
+#include "../Utils/FileSystem.h"
+
+/**
+ * Local cache of compressed blocks, in a directory with one file per block named by the hash of its original chunk <br>
+ * With content defined chunks (Chunker.h), the unchanged parts of an input compressed again give the same chunks,
+ * whose blocks are copied from the cache instead of going through the BWT again <br>
+ * The directory can be deleted at any time, it is filled again by the next compressions
+ *
+ * @Entry_Format
+ * CRC32C of the block (4 Bytes, LE), then the compressed block as in Format.h
+ */
+class ChunkCache {
+
+    std::string directory;
+
+public:
+
+    // Blocks taken from the cache and blocks compressed (and added to it)
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    explicit ChunkCache(const std::string& directory) : directory(directory) {}
+
+    // Creates the directory if needed, returns false if it can not be created
+    bool open() const {
+        return FileSystem::createDirectories(directory);
+    }
+
+    /**
+     * Name of the entry of a chunk, [variant] tells the options giving different blocks for the same chunk
+     */
+    static std::string key(const uint8_t* chunk, size_t length, const std::string& variant) {
+        uint64_t low = hash(chunk, length, 0x243F6A8885A308D3ull);
+        uint64_t high = hash(chunk, length, 0x13198A2E03707344ull);
+        return toHex(high) + toHex(low) + "-" + variant;
+    }
+
+    /**
+     * Reads the block of [key] to [block] <br>
+     * Returns false if there is none or it is damaged (as an interrupted write would leave it)
+     */
+    bool find(const std::string& key, std::vector<uint8_t>& block) const {
+        std::ifstream input(path(key), std::ios::in | std::ios::binary);
+        int64_t fileSize = BinaryIO::getFileSize(input);
+        if (fileSize < 4)
+            return false;
+
+        uint8_t checksum[4];
+        block.resize(fileSize - 4);
+        return BinaryIO::read(input, 0, checksum, sizeof(checksum)) &&
+               BinaryIO::read(input, 4, block.data(), block.size()) &&
+               BinaryIO::loadUint32(checksum) == CRC32C::compute(block.data(), block.size());
+    }
+
+    /**
+     * Adds the block of [key], written to a temporary file renamed once complete,
+     * so concurrent compressions never read a partial entry <br>
+     * The temporary file is named by the process and the thread, which are the only ones writing it
+     */
+    void store(const std::string& key, const uint8_t* block, size_t length) const {
+        std::string temporaryPath = path(key) + ".tmp" + std::to_string(FileSystem::processId()) + "-" +
+                                    std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            uint8_t checksum[4];
+            BinaryIO::storeUint32(checksum, CRC32C::compute(block, length));
+
+            std::ofstream output(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            output.write((const char*) checksum, sizeof(checksum));
+            output.write((const char*) block, length);
+            if (!output.good()) {
+                output.close();
+                remove(temporaryPath.c_str());
+                return;
+            }
+        }
+
+        remove(path(key).c_str()); // rename does not replace an existing file on Windows
+        if (rename(temporaryPath.c_str(), path(key).c_str()) != 0)
+            remove(temporaryPath.c_str());
+    }
+
+private:
+
+    std::string path(const std::string& key) const {
+        return directory + "/" + key;
+    }
+
+    /**
+     * 64 bits hash of [data], two seeds give two independent halves of the key <br>
+     * Rounds of xxHash64 on 8 bytes at a time, the blocks also hold the CRC32C of the chunk, checked on every hit
+     */
+    static uint64_t hash(const uint8_t* data, size_t length, uint64_t seed) {
+        const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+        const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+
+        uint64_t hash = seed + length * PRIME1;
+        for (; length >= 8; data += 8, length -= 8) {
+            uint64_t value = BinaryIO::loadUint64(data);
+            hash ^= rotateLeft(value * PRIME2, 31) * PRIME1;
+            hash = rotateLeft(hash, 27) * PRIME1 + PRIME2;
+        }
+        for (; length > 0; ++data, --length)
+            hash = rotateLeft(hash ^ (*data * PRIME1), 11) * PRIME2;
+
+        // Final mix, so every bit of the input changes half of the bits of the hash
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME1;
+        return hash ^ (hash >> 32);
+    }
+
+    static uint64_t rotateLeft(uint64_t value, uint32_t bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    static std::string toHex(uint64_t value) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) value);
+        return hex;
+    }
+
+};
+
+#endif //CHUNK_CACHE_H
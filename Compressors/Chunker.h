@@ -0,0 +1,69 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Content defined chunking (gear hash, as in FastCDC) <br>
+ * Blocks end where the hash of the last bytes matches a mask instead of at fixed offsets,
+ * so inserting or removing bytes only moves the boundaries around the change
+ * and the other blocks of a slightly modified input stay identical
+ */
+class Chunker {
+
+    // Random values of each byte, generated the same way everywhere (SplitMix64) so boundaries are reproducible
+    struct Table {
+        uint64_t values[256];
+
+        Table() {
+            uint64_t state = 0x9E3779B97F4A7C15ull;
+            for (uint64_t& value : values) {
+                uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                value = z ^ (z >> 31);
+            }
+        }
+    };
+
+    static const uint64_t* gear() {
+        static const Table table;
+        return table.values;
+    }
+
+public:
+
+    /**
+     * Length of the chunk starting at [data], between a quarter of [maximumSize] and [maximumSize] bytes,
+     * about half of it on average <br>
+     * [length] is the number of bytes left, fewer than maximumSize only at the end of the input
+     */
+    static size_t nextChunk(const uint8_t* data, size_t length, size_t maximumSize) {
+        if (length <= maximumSize / 4)
+            return length;
+
+        size_t minimumSize = maximumSize / 4;
+        size_t end = length < maximumSize ? length : maximumSize;
+
+        // A boundary is expected every 2^bits bytes after the minimum, with 2^bits <= maximumSize / 4
+        uint32_t bits = 0;
+        while (((size_t) 2 << bits) <= minimumSize)
+            bits++;
+
+        // The high bits of the hash depend on the last 64 bytes, the low ones only on the last few
+        uint64_t mask = (((uint64_t) 1 << bits) - 1) << (64 - bits);
+
+        const uint64_t* values = gear();
+        uint64_t hash = 0;
+        for (size_t i = minimumSize; i < end; ++i) {
+            hash = (hash << 1) + values[data[i]];
+            if ((hash & mask) == 0)
+                return i + 1;
+        }
+        return end;
+    }
+
+};
+
+#endif //CHUNKER_H
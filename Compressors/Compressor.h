@@ -1,24 +1,1416 @@
 #ifndef COMPRESSOR_H
 #define COMPRESSOR_H
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 #include "BWT/BWT.h"
+#include "Chunker.h"
+#include "ChunkCache.h"
+#include "Dictionary.h"
+#include "FMIndex.h"
 #include "MTF.h"
 #include "LZW/LZW.h"
+#include "LZW/Utils.h"
+#include "Format.h"
+#include "Huffman/Huffman.h"
+#include "LongRange.h"
+#include "NumericTransform.h"
+#include "RLE.h"
+#include "WordTransform.h"
+#include "../Utils/BinaryIO.h"
+#include "../Utils/BitIO.h"
+#include "../Utils/ScratchArena.h"
+#include "../Utils/ContextPool.h"
+#include "../Utils/CRC32C.h"
+#include "../Utils/Stats.h"
 
+/**
+ * BWT -> MTF -> LZW pipeline, applied to each block of the input (see Format.h),
+ * the adaptive mode can choose Huffman coding or storing instead for each block <br>
+ * The BWT of the blocks can be indexed, so search() finds a pattern without decompressing them <br>
+ * The optional long range matching is applied to the whole input before splitting it in blocks
+ */
 namespace Compressor {
 
-    void compress(const std::string& toBeCompressedFilename, const std::string& outputFilename) {
-        BWT::encode(toBeCompressedFilename, outputFilename);
-        MTF::encode(outputFilename, outputFilename); // same filename will makes it write output to the same file
-        LZW::encode(outputFilename, outputFilename); // same filename will makes it write output to the same file
+    /**
+     * Returned instead of a size when the output does not fit, the input is too large or it is corrupted
+     */
+    const size_t INVALID_SIZE = SIZE_MAX;
+
+    inline bool isError(size_t result) {
+        return result == INVALID_SIZE;
+    }
+
+    struct Options {
+        uint32_t blockSize = Format::DEFAULT_BLOCK_SIZE;
+
+        // Removes repeats between distant blocks, needs the whole input in memory
+        bool longRange = false;
+
+        // Shortens runs of equal bytes in each block before the BWT
+        bool runLength = false;
+
+        // Replaces the frequent words of each block by short codes before the BWT (and the RLE), for text
+        bool wordTransform = false;
+
+        // Filters each block as an array of records before the BWT (and the RLE), for numeric data (NumericTransform.h).
+        // Operation::DETECT chooses the filter of each block from a sample of it, the word transform goes first
+        NumericTransform::Filter numericFilter;
+
+        // Primes the LZW of each block, the same dictionary is needed to decompress
+        const Dictionary* dictionary = nullptr;
+
+        // Splits the input in content defined chunks instead of fixed blocks (see Chunker.h),
+        // the blocks of the chunks found in the cache are reused instead of compressed again
+        ChunkCache* chunkCache = nullptr;
+
+        // Chooses the pipeline of each block (BWT -> MTF -> LZW, Huffman or stored) by compressing a sample of it
+        bool adaptive = false;
+
+        // Megabytes per second the adaptive mode must compress the samples at, 0 for no limit
+        uint32_t minimumSpeed = 0;
+
+        // Stores an FM-index with the BWT of each block (see FMIndex.h), so search() only decodes a few segments of it.
+        // Blocks shortened by the run length encoding are not indexed
+        bool searchIndex = false;
+    };
+
+    // Sample of each block compressed by every pipeline in the adaptive mode, in slices spread over the block
+    const uint32_t SAMPLE_SLICES = 4;
+    const uint32_t SAMPLE_SLICE_SIZE = 16u << 10;
+
+    /**
+     * Contexts of all the stages, sharing one scratch memory reused by consecutive calls,
+     * so their buffers are not allocated again once it has grown (except the ones of Huffman, see ScratchArena.h) <br>
+     * A context must not be used by more than one thread at a time,
+     * use a ContextPool<Compressor::Context> to run many compressions concurrently
+     */
+    class Context {
+    public:
+        ScratchArena arena;
+
+        BWT::Encoder bwtEncoder;
+        BWT::Decoder bwtDecoder;
+        MTF::Encoder mtfEncoder;
+        MTF::Decoder mtfDecoder;
+        LZW::Encoder lzwEncoder;
+        LZW::Decoder lzwDecoder;
+        Huffman::Encoder huffmanEncoder;
+        Huffman::Decoder huffmanDecoder;
+
+        // Receives the time, the sizes and the scratch memory of each stage if it is set
+        Stats::Recorder* stats = nullptr;
+
+        // Used to decompress data compressed with a dictionary, it must have the ID stored in the header
+        const Dictionary* dictionary = nullptr;
+
+        Context() : bwtEncoder(arena), bwtDecoder(arena), lzwEncoder(arena), lzwDecoder(arena) {}
+
+        // Threads sharing the stages of a large block which can be split, only the MTF for now.
+        // The calling thread codes a part of the block, so the pool only starts the other ones, once
+        void setNumberOfThreads(uint32_t numberOfThreads) {
+            helpers.reset(numberOfThreads > 1 ? new ThreadPool(numberOfThreads - 1) : nullptr);
+            mtfEncoder.setHelpers(helpers.get());
+            mtfDecoder.setHelpers(helpers.get());
+        }
+
+        // Context used by the functions called without one, there is one per thread
+        static Context& forCurrentThread() {
+            static thread_local Context context;
+            return context;
+        }
+
+    private:
+        // Workers coding the segments of a large block with the calling thread, none until they are needed
+        std::unique_ptr<ThreadPool> helpers;
+    };
+
+    // Bits of the widest LZW word of a block of [length] bytes
+    inline size_t maximumWordLength(size_t length, const Dictionary* dictionary) {
+        // Every LZW word encodes at least one byte (plus the BWT sentinel)
+        // and is at most as wide as the dictionary size after the last word, primed words included
+        size_t words = length + 1;
+        size_t primedWords = dictionary != nullptr ? dictionary->primer().size() : 0;
+        return numberOfBitsToStoreRangeOf((uint32_t) std::min(words + primedWords + 257, (size_t) UINT32_MAX));
+    }
+
+    /**
+     * Maximum compressed size of a single block of [length] bytes, compressed with [dictionary] if it is set
+     * and indexed if [isSearchable] is set (Options::searchIndex)
+     */
+    inline size_t compressBlockBound(size_t length, const Dictionary* dictionary = nullptr, bool isSearchable = false) {
+        return Format::BLOCK_HEADER_SIZE + NumericTransform::FILTER_SIZE +
+               ((length + 1) * maximumWordLength(length, dictionary) + 7) / 8 +
+               (isSearchable ? FMIndex::indexBound(length, 1) : 0);
+    }
+
+    /**
+     * Maximum compressed size of [length] bytes, an output buffer of this size never overflows <br>
+     * [dictionary] and [isSearchable] are as in compressBlockBound
+     */
+    inline size_t compressBound(size_t length, uint32_t blockSize = Format::DEFAULT_BLOCK_SIZE,
+                                const Dictionary* dictionary = nullptr, bool isSearchable = false) {
+        length = LongRange::encodeBound(length);
+
+        // Content defined chunks (see Options::chunkCache) are at least a quarter of a block, except the last one
+        size_t numberOfBlocks = length / (blockSize / 4) + 1;
+
+        // Each block is bounded as in compressBlockBound, with the words of the biggest one and one byte of rounding
+        size_t wordLength = maximumWordLength(std::min(length, (size_t) blockSize), dictionary);
+        size_t blocksBound = numberOfBlocks * (Format::BLOCK_HEADER_SIZE + NumericTransform::FILTER_SIZE + 1) +
+                             ((length + numberOfBlocks) * wordLength + 7) / 8 +
+                             (isSearchable ? FMIndex::indexBound(length, numberOfBlocks) : 0);
+
+        return Format::HEADER_SIZE + blocksBound + Format::indexSize(numberOfBlocks) + Format::FOOTER_SIZE;
+    }
+
+    /**
+     * BWT -> MTF -> LZW of a block to [output], returns the size of the LZW words or INVALID_SIZE if they do not fit <br>
+     * If [isSearchable] is set, the BWT is coded in segments after its FM-index instead (see FMIndex.h)
+     */
+    inline size_t encodeBWT(const uint8_t* input, uint32_t length, uint8_t* output, size_t capacity,
+                            uint32_t& originalIndex, const Options& options, Context& context, bool isSearchable = false) {
+        ScratchArena::Scope scope(context.arena);
+
+        uint8_t* transformed = context.arena.allocate<uint8_t>(length + 1);
+        uint32_t* samples = isSearchable ? context.arena.allocate<uint32_t>(FMIndex::numberOfSamples(length)) : nullptr;
+        {
+            // The suffix array is built here instead of inside the BWT, so both are measured separately
+            ScratchArena::Scope suffixArrayScope(context.arena);
+            uint32_t* suffixArray;
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::SuffixArray, length, &context.arena);
+                suffixArray = context.arena.allocate<uint32_t>(length);
+                SuffixArray::buildSuffixArray(input, length, suffixArray, context.arena);
+                measure.setBytesOut((uint64_t) length * sizeof(uint32_t));
+            }
+
+            Stats::Measure measure(context.stats, Stats::Stage::BWT, length, &context.arena);
+            originalIndex = context.bwtEncoder.encode(input, length, suffixArray, transformed);
+            if (isSearchable)
+                FMIndex::sample(suffixArray, length, samples);
+            measure.setBytesOut(length + 1);
+        }
+
+        const LZW::Primer* primer = options.dictionary != nullptr ? &options.dictionary->primer() : nullptr;
+        if (isSearchable) {
+            Stats::Measure measure(context.stats, Stats::Stage::FMIndex, length + 1, &context.arena);
+            size_t compressedSize = FMIndex::encode(transformed, length, samples, output, capacity,
+                                                    context.mtfEncoder, context.lzwEncoder, primer);
+            measure.setBytesOut(compressedSize == SIZE_MAX ? 0 : compressedSize);
+            return compressedSize == SIZE_MAX ? INVALID_SIZE : compressedSize;
+        }
+
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::MTF, length + 1);
+            context.mtfEncoder.reset();
+            context.mtfEncoder.encode(transformed, length + 1);
+            measure.addCpuSeconds(context.mtfEncoder.helperCpuSeconds());
+            measure.setBytesOut(length + 1);
+        }
+
+        BitWriter writer(output, capacity);
+        size_t compressedSize;
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::LZW, length + 1, &context.arena);
+            context.lzwEncoder.encode(transformed, length + 1, writer, primer);
+            compressedSize = writer.flush();
+            measure.setBytesOut(compressedSize);
+        }
+
+        return writer.overflowed() ? INVALID_SIZE : compressedSize;
+    }
+
+    /**
+     * Inverse of encodeBWT, decodes the LZW words of [input] to [output] which has room for [capacity] bytes <br>
+     * Returns the decoded size, or INVALID_SIZE if the block is corrupted
+     */
+    inline size_t decodeBWT(const uint8_t* input, size_t length, uint32_t originalIndex, uint8_t* output,
+                            uint32_t capacity, const Dictionary* dictionary, Context& context) {
+        ScratchArena::Scope scope(context.arena);
+
+        uint8_t* transformed = context.arena.allocate<uint8_t>((size_t) capacity + 1);
+        BitReader reader(input, length);
+        LZW::BufferSink sink(transformed, (size_t) capacity + 1);
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::LZW, length, &context.arena);
+            bool isValid = context.lzwDecoder.decode(reader, sink, dictionary != nullptr ? &dictionary->primer() : nullptr);
+            measure.setBytesOut(sink.size);
+
+            if (!isValid || sink.size == 0)
+                return INVALID_SIZE;
+        }
+        uint32_t transformedSize = sink.size;
+
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::MTF, transformedSize);
+            context.mtfDecoder.reset();
+            context.mtfDecoder.decode(transformed, transformedSize);
+            measure.addCpuSeconds(context.mtfDecoder.helperCpuSeconds());
+            measure.setBytesOut(transformedSize);
+        }
+
+        Stats::Measure measure(context.stats, Stats::Stage::BWT, transformedSize, &context.arena);
+        bool isValid = context.bwtDecoder.decode(transformed, transformedSize, originalIndex, output);
+        measure.setBytesOut(isValid ? transformedSize - 1 : 0);
+        return isValid ? transformedSize - 1 : INVALID_SIZE;
+    }
+
+    /**
+     * Inverse of encodeBWT for a searchable block of [originalSize] bytes, which is never run length encoded <br>
+     * Returns false if the block is corrupted
+     */
+    inline bool decodeSearchable(const uint8_t* input, size_t length, uint32_t originalIndex, uint8_t* output,
+                                 uint32_t originalSize, const Dictionary* dictionary, Context& context) {
+        ScratchArena::Scope scope(context.arena);
+
+        FMIndex index(context.mtfDecoder, context.lzwDecoder, dictionary != nullptr ? &dictionary->primer() : nullptr);
+        uint8_t* transformed = context.arena.allocate<uint8_t>((size_t) originalSize + 1);
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::FMIndex, length, &context.arena);
+            bool isValid = index.open(input, length, originalSize, originalIndex) && index.decode(transformed);
+            measure.setBytesOut(isValid ? originalSize + 1 : 0);
+
+            if (!isValid)
+                return false;
+        }
+
+        Stats::Measure measure(context.stats, Stats::Stage::BWT, originalSize + 1, &context.arena);
+        bool isValid = context.bwtDecoder.decode(transformed, originalSize + 1, originalIndex, output);
+        measure.setBytesOut(isValid ? originalSize : 0);
+        return isValid;
+    }
+
+    /**
+     * Pipeline of a block in the adaptive mode, predicted by compressing a sample of the block with each of them <br>
+     * The smallest output wins among the pipelines compressing the sample at options.minimumSpeed at least
+     * (storing always does), so without a minimum speed the choice only depends on the data
+     */
+    inline uint8_t choosePipeline(const uint8_t* input, uint32_t length, const Options& options, Context& context) {
+        if (length == 0)
+            return Format::PIPELINE_STORED;
+
+        Stats::Measure measure(context.stats, Stats::Stage::Sampling, length, &context.arena);
+        ScratchArena::Scope scope(context.arena);
+
+        // Slices spread from the start to the end, so a block starting with a header is not judged on it alone
+        uint32_t sampleSize = std::min(length, SAMPLE_SLICES * SAMPLE_SLICE_SIZE);
+        uint8_t* sample = context.arena.allocate<uint8_t>(sampleSize);
+        if (sampleSize == length) {
+            memcpy(sample, input, length);
+        } else {
+            for (uint32_t i = 0; i < SAMPLE_SLICES; ++i) {
+                uint64_t start = (uint64_t) (length - SAMPLE_SLICE_SIZE) * i / (SAMPLE_SLICES - 1);
+                memcpy(sample + i * SAMPLE_SLICE_SIZE, input + start, SAMPLE_SLICE_SIZE);
+            }
+        }
+
+        // Only the whole sampling is reported, not the stages of each trial
+        Stats::Recorder* stats = context.stats;
+        context.stats = nullptr;
+        context.huffmanEncoder.stats = nullptr;
+
+        size_t capacity = compressBlockBound(sampleSize, options.dictionary);
+        uint8_t* compressed = context.arena.allocate<uint8_t>(capacity);
+
+        // Ties go to the BWT, it gains more than the sample shows on a whole block
+        uint8_t bestPipeline = Format::PIPELINE_STORED;
+        size_t bestSize = sampleSize;
+        for (uint8_t pipeline : {Format::PIPELINE_BWT, Format::PIPELINE_HUFFMAN}) {
+            auto start = std::chrono::steady_clock::now();
+            uint32_t originalIndex;
+            size_t size = pipeline == Format::PIPELINE_BWT
+                          ? encodeBWT(sample, sampleSize, compressed, capacity, originalIndex, options, context)
+                          : context.huffmanEncoder.encode(sample, sampleSize, compressed, capacity);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            bool isFastEnough = options.minimumSpeed == 0 || sampleSize / 1e6 >= options.minimumSpeed * seconds;
+            if (!isError(size) && isFastEnough && size < bestSize) {
+                bestPipeline = pipeline;
+                bestSize = size;
+            }
+        }
+
+        context.stats = stats;
+        measure.setBytesOut(sampleSize);
+        return bestPipeline;
+    }
+
+    /**
+     * Numeric filter of a block when options.numericFilter detects it, the one NumericTransform::detect finds
+     * for a sample of the block if the BWT chain compresses the filtered sample smaller than the raw one <br>
+     * Returns a filter of operation NONE otherwise
+     */
+    inline NumericTransform::Filter chooseNumericFilter(const uint8_t* input, uint32_t length, const Options& options,
+                                                        Context& context) {
+        Stats::Measure measure(context.stats, Stats::Stage::Sampling, length, &context.arena);
+        ScratchArena::Scope scope(context.arena);
+
+        // One slice from the middle, the records must follow each other and a header at the start would mislead it
+        uint32_t sampleSize = std::min(length, SAMPLE_SLICES * SAMPLE_SLICE_SIZE);
+        const uint8_t* sample = input + (length - sampleSize) / 2;
+        NumericTransform::Filter filter = NumericTransform::detect(sample, sampleSize);
+        if (filter.operation == NumericTransform::Operation::NONE) {
+            measure.setBytesOut(sampleSize);
+            return filter;
+        }
+
+        Stats::Recorder* stats = context.stats;
+        context.stats = nullptr;
+
+        uint8_t* filtered = context.arena.allocate<uint8_t>(sampleSize);
+        NumericTransform::encode(sample, sampleSize, filtered, filter);
+
+        size_t capacity = compressBlockBound(sampleSize, options.dictionary);
+        uint8_t* compressed = context.arena.allocate<uint8_t>(capacity);
+        uint32_t originalIndex;
+        size_t rawSize = encodeBWT(sample, sampleSize, compressed, capacity, originalIndex, options, context);
+        size_t filteredSize = encodeBWT(filtered, sampleSize, compressed, capacity, originalIndex, options, context);
+        if (isError(filteredSize) || (!isError(rawSize) && filteredSize >= rawSize))
+            filter.operation = NumericTransform::Operation::NONE;
+
+        context.stats = stats;
+        measure.setBytesOut(sampleSize);
+        return filter;
+    }
+
+    /**
+     * Compresses a single block with the RLE if [isRunLength] is set and it makes the block smaller <br>
+     * Returns its compressed size or INVALID_SIZE if it does not fit in [capacity]
+     */
+    inline size_t encodeBlock(const uint8_t* input, uint32_t length, uint8_t* output, size_t capacity,
+                              const Options& options, bool isRunLength, Context& context) {
+        if (capacity < Format::BLOCK_HEADER_SIZE)
+            return INVALID_SIZE;
+
+        ScratchArena::Scope scope(context.arena);
+
+        uint32_t checksum;
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::Checksum, length);
+            checksum = CRC32C::compute(input, length);
+            measure.setBytesOut(sizeof(checksum));
+        }
+
+        // The transforms are only kept if they make the block smaller
+        uint8_t blockFlags = 0;
+        if (options.wordTransform && length > 0) {
+            Stats::Measure measure(context.stats, Stats::Stage::WordTransform, length, &context.arena);
+
+            uint8_t* encoded = context.arena.allocate<uint8_t>(length);
+            size_t encodedSize = WordTransform::encode(input, length, encoded, length - 1);
+            if (!isError(encodedSize)) {
+                input = encoded;
+                length = encodedSize;
+                blockFlags |= Format::BLOCK_FLAG_WORDS;
+            }
+            measure.setBytesOut(length);
+        }
+
+        // The filter keeps the size, so it is kept if it was asked for or if it compresses the sample better
+        NumericTransform::Filter numericFilter = options.numericFilter;
+        if (numericFilter.operation == NumericTransform::Operation::DETECT && blockFlags == 0 && length > 0)
+            numericFilter = chooseNumericFilter(input, length, options, context);
+        bool isNumeric = NumericTransform::isValid(numericFilter) && blockFlags == 0 && length > 0;
+        if (isNumeric) {
+            Stats::Measure measure(context.stats, Stats::Stage::NumericTransform, length, &context.arena);
+
+            uint8_t* encoded = context.arena.allocate<uint8_t>(length);
+            NumericTransform::encode(input, length, encoded, numericFilter);
+            input = encoded;
+            blockFlags |= Format::BLOCK_FLAG_NUMERIC;
+            measure.setBytesOut(length);
+        }
+
+        if (isRunLength && length > 0) {
+            Stats::Measure measure(context.stats, Stats::Stage::RLE, length, &context.arena);
+
+            uint8_t* encoded = context.arena.allocate<uint8_t>(length);
+            size_t encodedSize = RLE::encode(input, length, encoded, length > 0 ? length - 1 : 0);
+            if (!isError(encodedSize)) {
+                input = encoded;
+                length = encodedSize;
+                blockFlags |= Format::BLOCK_FLAG_RUN_LENGTH;
+            }
+            measure.setBytesOut(length);
+        }
+
+        size_t headerSize = Format::BLOCK_HEADER_SIZE + (isNumeric ? NumericTransform::FILTER_SIZE : 0);
+        if (capacity < headerSize)
+            return INVALID_SIZE;
+
+        uint8_t pipeline = options.adaptive ? choosePipeline(input, length, options, context) : Format::PIPELINE_BWT;
+        uint8_t* data = output + headerSize;
+        size_t dataCapacity = capacity - headerSize;
+        uint32_t originalIndex = 0;
+        size_t dataSize = INVALID_SIZE;
+        if (pipeline == Format::PIPELINE_BWT) {
+            // The index of a transformed block would find the transformed bytes instead of the original ones
+            bool isSearchable = options.searchIndex && blockFlags == 0;
+            dataSize = encodeBWT(input, length, data, dataCapacity, originalIndex, options, context, isSearchable);
+            if (isSearchable)
+                pipeline = Format::PIPELINE_SEARCHABLE;
+        } else if (pipeline == Format::PIPELINE_HUFFMAN) {
+            context.huffmanEncoder.stats = context.stats;
+            dataSize = context.huffmanEncoder.encode(input, length, data, dataCapacity);
+        }
+
+        // The sample can be wrong, the adaptive mode still never makes a block bigger than stored
+        if (pipeline == Format::PIPELINE_STORED || (options.adaptive && (isError(dataSize) || dataSize >= length))) {
+            pipeline = Format::PIPELINE_STORED;
+            originalIndex = 0;
+            dataSize = length <= dataCapacity ? length : INVALID_SIZE;
+            if (!isError(dataSize))
+                memcpy(data, input, length);
+        }
+
+        if (isError(dataSize))
+            return INVALID_SIZE;
+
+        output[0] = blockFlags | (pipeline << Format::BLOCK_PIPELINE_SHIFT);
+        BinaryIO::storeUint32(output + 1, originalIndex);
+        BinaryIO::storeUint32(output + 5, checksum);
+        if (isNumeric)
+            NumericTransform::storeFilter(output + Format::BLOCK_HEADER_SIZE, numericFilter);
+        return headerSize + dataSize;
+    }
+
+    /**
+     * Compresses a single block, returns its compressed size or INVALID_SIZE if it does not fit in [capacity] <br>
+     * A block the RLE shortens is also compressed without it, the BWT codes most runs in a few bytes
+     * and the RLE hides the bytes around them from its contexts, so the smaller output is kept
+     */
+    inline size_t compressBlock(const uint8_t* input, uint32_t length, uint8_t* output, size_t capacity,
+                                const Options& options, Context& context) {
+        size_t compressedSize = encodeBlock(input, length, output, capacity, options, options.runLength, context);
+        bool isRunLength = !isError(compressedSize) && (output[0] & Format::BLOCK_FLAG_RUN_LENGTH) != 0;
+        if (!options.runLength || (!isError(compressedSize) && !isRunLength))
+            return compressedSize;
+
+        ScratchArena::Scope scope(context.arena);
+        uint8_t* plain = context.arena.allocate<uint8_t>(capacity);
+        size_t plainSize = encodeBlock(input, length, plain, capacity, options, false, context);
+        if (isError(plainSize) || (!isError(compressedSize) && plainSize >= compressedSize))
+            return compressedSize;
+
+        memcpy(output, plain, plainSize);
+        return plainSize;
+    }
+
+    /**
+     * Decompresses a single block to [output] which must have room for [originalSize] bytes,
+     * [dictionary] is the one it was compressed with <br>
+     * Returns false if the block is corrupted, its checksum catches what the decoders can not see
+     */
+    inline bool decompressBlock(const uint8_t* input, size_t length, uint8_t* output, uint32_t originalSize, Context& context,
+                                const Dictionary* dictionary = nullptr) {
+        if (length < Format::BLOCK_HEADER_SIZE)
+            return false;
+
+        ScratchArena::Scope scope(context.arena);
+
+        uint8_t blockFlags = input[0];
+        uint32_t originalIndex = BinaryIO::loadUint32(input + 1);
+        uint32_t checksum = BinaryIO::loadUint32(input + 5);
+        uint8_t pipeline = (blockFlags & Format::BLOCK_PIPELINE_MASK) >> Format::BLOCK_PIPELINE_SHIFT;
+        bool isRunLength = (blockFlags & Format::BLOCK_FLAG_RUN_LENGTH) != 0;
+        bool isWords = (blockFlags & Format::BLOCK_FLAG_WORDS) != 0;
+        bool isNumeric = (blockFlags & Format::BLOCK_FLAG_NUMERIC) != 0;
+        if ((blockFlags & ~Format::KNOWN_BLOCK_FLAGS) != 0 || pipeline >= Format::NUMBER_OF_PIPELINES ||
+            (isWords && (isNumeric || originalSize == 0)) || (isRunLength && originalSize <= (isWords ? 1u : 0u)))
+            return false;
+
+        size_t headerSize = Format::BLOCK_HEADER_SIZE + (isNumeric ? NumericTransform::FILTER_SIZE : 0);
+        NumericTransform::Filter numericFilter;
+        if (length < headerSize ||
+            (isNumeric && !NumericTransform::loadFilter(input + Format::BLOCK_HEADER_SIZE, numericFilter)))
+            return false;
+
+        // The word transform and the RLE are shorter than their input (the numeric filter has the same size),
+        // their sizes are only known once they are decoded
+        uint32_t transformedCapacity = isWords ? originalSize - 1 : originalSize;
+        uint32_t capacity = isRunLength ? transformedCapacity - 1 : transformedCapacity;
+        uint8_t* transformed = isWords || isNumeric ? context.arena.allocate<uint8_t>(transformedCapacity) : output;
+        uint8_t* decoded = isRunLength ? context.arena.allocate<uint8_t>(capacity) : transformed;
+        const uint8_t* data = input + headerSize;
+        size_t dataSize = length - headerSize;
+
+        size_t decodedSize;
+        if (pipeline == Format::PIPELINE_BWT) {
+            decodedSize = decodeBWT(data, dataSize, originalIndex, decoded, capacity, dictionary, context);
+        } else if (pipeline == Format::PIPELINE_SEARCHABLE) {
+            bool isValid = !isRunLength && !isWords && !isNumeric &&
+                           decodeSearchable(data, dataSize, originalIndex, decoded, capacity, dictionary, context);
+            decodedSize = isValid ? capacity : INVALID_SIZE;
+        } else if (pipeline == Format::PIPELINE_HUFFMAN) {
+            context.huffmanDecoder.stats = context.stats;
+            decodedSize = context.huffmanDecoder.decode(data, dataSize, decoded, capacity);
+        } else {
+            decodedSize = dataSize <= capacity ? dataSize : INVALID_SIZE;
+            if (!isError(decodedSize))
+                memcpy(decoded, data, dataSize);
+        }
+
+        if (isError(decodedSize) || (decoded == output && decodedSize != originalSize))
+            return false;
+
+        if (isRunLength) {
+            Stats::Measure measure(context.stats, Stats::Stage::RLE, decodedSize);
+            decodedSize = RLE::decode(decoded, decodedSize, transformed, transformedCapacity);
+            measure.setBytesOut(isError(decodedSize) ? 0 : decodedSize);
+
+            if (isError(decodedSize) || (transformed == output && decodedSize != originalSize))
+                return false;
+        }
+
+        if (isWords) {
+            Stats::Measure measure(context.stats, Stats::Stage::WordTransform, decodedSize);
+            decodedSize = WordTransform::decode(transformed, decodedSize, output, originalSize);
+            measure.setBytesOut(isError(decodedSize) ? 0 : decodedSize);
+
+            if (decodedSize != originalSize)
+                return false;
+        } else if (isNumeric) {
+            if (decodedSize != originalSize)
+                return false;
+
+            Stats::Measure measure(context.stats, Stats::Stage::NumericTransform, decodedSize);
+            NumericTransform::decode(transformed, decodedSize, output, numericFilter);
+            measure.setBytesOut(decodedSize);
+        }
+
+        Stats::Measure measure(context.stats, Stats::Stage::Checksum, originalSize);
+        bool isValid = CRC32C::compute(output, originalSize) == checksum;
+        measure.setBytesOut(sizeof(checksum));
+        return isValid;
+    }
+
+
+    /**
+     * Size of the block starting at [data], [length] bytes are left (at most a block) <br>
+     * It is all of them, unless the input is split in content defined chunks
+     */
+    inline uint32_t nextBlockSize(const uint8_t* data, uint32_t length, const Options& options, Context& context) {
+        if (options.chunkCache == nullptr)
+            return length;
+
+        Stats::Measure measure(context.stats, Stats::Stage::ChunkCache, length);
+        uint32_t chunkSize = Chunker::nextChunk(data, length, options.blockSize);
+        measure.setBytesOut(chunkSize);
+        return chunkSize;
+    }
+
+    // Options which change the blocks of the same chunk
+    inline std::string chunkCacheVariant(const Options& options) {
+        std::string variant = "v" + std::to_string(Format::VERSION);
+        if (options.runLength)
+            variant += "r";
+        if (options.wordTransform)
+            variant += "w";
+        if (options.numericFilter.operation != NumericTransform::Operation::NONE)
+            variant += "n" + std::to_string((int) options.numericFilter.operation) + "." +
+                       std::to_string(options.numericFilter.width) + "." + std::to_string(options.numericFilter.stride);
+        if (options.dictionary != nullptr)
+            variant += "d" + std::to_string(options.dictionary->id());
+        if (options.adaptive)
+            variant += "a" + std::to_string(options.minimumSpeed);
+        if (options.searchIndex)
+            variant += "i";
+        return variant;
+    }
+
+    /**
+     * Same as compressBlock, the block of a chunk found in options.chunkCache is copied instead of compressed again
+     * (after checking its checksum matches the chunk), the others are added to the cache
+     */
+    inline size_t compressCachedBlock(const uint8_t* input, uint32_t length, uint8_t* output, size_t capacity,
+                                      const Options& options, Context& context) {
+        ChunkCache* cache = options.chunkCache;
+        if (cache == nullptr)
+            return compressBlock(input, length, output, capacity, options, context);
+
+        std::string key;
+        std::vector<uint8_t> block;
+        bool isCached;
+        {
+            Stats::Measure measure(context.stats, Stats::Stage::ChunkCache, length);
+            key = ChunkCache::key(input, length, chunkCacheVariant(options));
+            isCached = cache->find(key, block) && block.size() >= Format::BLOCK_HEADER_SIZE && block.size() <= capacity &&
+                       BinaryIO::loadUint32(block.data() + 5) == CRC32C::compute(input, length);
+            measure.setBytesOut(isCached ? block.size() : 0);
+        }
+
+        if (isCached) {
+            cache->hits++;
+            memcpy(output, block.data(), block.size());
+            return block.size();
+        }
+
+        size_t compressedSize = compressBlock(input, length, output, capacity, options, context);
+        if (!isError(compressedSize)) {
+            cache->misses++;
+            cache->store(key, output, compressedSize);
+        }
+        return compressedSize;
+    }
+
+    /**
+     * Trains a dictionary of at most [maximumSize] bytes for small inputs like [samples] <br>
+     * It is the MTF of the BWT of each sample, one after the other until it is full,
+     * so its words are the ones the LZW learns at the start of such inputs
+     */
+    inline Dictionary trainDictionary(const std::vector<std::vector<uint8_t>>& samples,
+                                      size_t maximumSize = Dictionary::DEFAULT_SIZE,
+                                      Context& context = Context::forCurrentThread()) {
+        maximumSize = std::min(maximumSize, (size_t) Dictionary::MAXIMUM_SIZE);
+
+        std::vector<uint8_t> content;
+        for (const std::vector<uint8_t>& sample : samples) {
+            uint32_t length = std::min(sample.size(), maximumSize);
+            if (content.size() == maximumSize || length == 0)
+                continue;
+
+            {
+                ScratchArena::Scope scope(context.arena);
+                uint8_t* transformed = context.arena.allocate<uint8_t>(length + 1);
+                context.bwtEncoder.encode(sample.data(), length, transformed);
+                context.mtfEncoder.reset();
+                context.mtfEncoder.encode(transformed, length + 1);
+
+                size_t used = std::min((size_t) length + 1, maximumSize - content.size());
+                content.insert(content.end(), transformed, transformed + used);
+            }
+            context.arena.reset();
+        }
+
+        return Dictionary(std::move(content));
+    }
+
+    /**
+     * Header, footer and index of a compressed buffer or file
+     */
+    struct Container {
+        Format::Header header;
+        Format::Footer footer;
+        std::vector<Format::BlockEntry> blocks;
+    };
+
+    // Checks the footer against the header and the size of the compressed data, before reading the index
+    inline bool isConsistent(const Container& container, uint64_t length) {
+        const Format::Footer& footer = container.footer;
+        if (footer.indexOffset < Format::HEADER_SIZE || footer.indexOffset > length ||
+            length - footer.indexOffset != Format::indexSize(footer.numberOfBlocks) + Format::FOOTER_SIZE)
+            return false;
+
+        // Without filters the blocks hold the original data as is
+        if (container.header.flags == 0)
+            return footer.dataSize == container.header.originalSize;
+        return footer.dataSize <= LongRange::encodeBound(container.header.originalSize);
+    }
+
+    /**
+     * Reads the header, the footer and the index of a compressed buffer <br>
+     * Returns false if it is not compressed by this version or it is corrupted
+     */
+    inline bool readContainer(const uint8_t* input, size_t length, Container& container) {
+        if (length < Format::HEADER_SIZE + Format::FOOTER_SIZE || !Format::readHeader(input, length, container.header))
+            return false;
+
+        if (!Format::readFooter(input + length - Format::FOOTER_SIZE, container.footer) || !isConsistent(container, length))
+            return false;
+
+        return Format::readIndex(input + container.footer.indexOffset, container.footer, container.header.blockSize,
+                                 container.blocks);
+    }
+
+    /**
+     * Same as readContainer for a compressed file, only the header, the footer and the index are read
+     */
+    inline bool readContainer(std::ifstream& input, Container& container) {
+        uint64_t fileSize = BinaryIO::getFileSize(input);
+
+        uint8_t header[Format::HEADER_SIZE];
+        uint8_t footer[Format::FOOTER_SIZE];
+        if (fileSize < Format::HEADER_SIZE + Format::FOOTER_SIZE ||
+            !BinaryIO::read(input, 0, header, sizeof(header)) ||
+            !Format::readHeader(header, sizeof(header), container.header))
+            return false;
+
+        if (!BinaryIO::read(input, fileSize - Format::FOOTER_SIZE, footer, sizeof(footer)) ||
+            !Format::readFooter(footer, container.footer) || !isConsistent(container, fileSize))
+            return false;
+
+        std::vector<uint8_t> index(Format::indexSize(container.footer.numberOfBlocks));
+        return BinaryIO::read(input, container.footer.indexOffset, index.data(), index.size()) &&
+               Format::readIndex(index.data(), container.footer, container.header.blockSize, container.blocks);
+    }
+
+    /**
+     * Finds the dictionary the blocks were compressed with, nullptr if there is none <br>
+     * Returns false if the context does not hold it
+     */
+    inline bool findDictionary(const Container& container, const Context& context, const Dictionary*& dictionary) {
+        dictionary = nullptr;
+        if (container.header.dictionaryId == Format::NO_DICTIONARY)
+            return true;
+
+        if (context.dictionary == nullptr || context.dictionary->id() != container.header.dictionaryId)
+            return false;
+
+        dictionary = context.dictionary;
+        return true;
+    }
+
+    /**
+     * Original size stored in [input], or INVALID_SIZE if it is not compressed by this version
+     */
+    inline size_t getDecompressedSize(const uint8_t* input, size_t length) {
+        Container container;
+        if (!readContainer(input, length, container))
+            return INVALID_SIZE;
+
+        return container.header.originalSize;
+    }
+
+    /**
+     * Splits [data] in blocks and writes them between the header and the index to [output] which can hold [capacity] bytes <br>
+     * Returns the compressed size, or INVALID_SIZE if it does not fit
+     */
+    inline size_t compressBlocks(const uint8_t* data, size_t dataSize, const Format::Header& header,
+                                 uint8_t* output, size_t capacity, const Options& options, Context& context) {
+
+        if (capacity < Format::HEADER_SIZE)
+            return INVALID_SIZE;
+
+        Format::writeHeader(output, header);
+        size_t compressedSize = Format::HEADER_SIZE;
+
+        std::vector<Format::BlockEntry> blocks;
+        for (size_t offset = 0; offset < dataSize;) {
+            uint32_t originalSize = nextBlockSize(data + offset, std::min(dataSize - offset, (size_t) header.blockSize),
+                                                  options, context);
+
+            size_t blockCompressedSize = compressCachedBlock(data + offset, originalSize, output + compressedSize,
+                                                             capacity - compressedSize, options, context);
+            context.arena.reset();
+
+            if (isError(blockCompressedSize))
+                return INVALID_SIZE;
+
+            blocks.push_back({offset, compressedSize, originalSize, (uint32_t) blockCompressedSize});
+            compressedSize += blockCompressedSize;
+            offset += originalSize;
+        }
+
+        Format::Footer footer = {dataSize, compressedSize, (uint32_t) blocks.size()};
+        if (capacity - compressedSize < Format::indexSize(footer.numberOfBlocks) + Format::FOOTER_SIZE)
+            return INVALID_SIZE;
+
+        Format::writeIndex(output + compressedSize, blocks);
+        compressedSize += Format::indexSize(footer.numberOfBlocks);
+
+        Format::writeFooter(output + compressedSize, footer);
+        return compressedSize + Format::FOOTER_SIZE;
+    }
+
+    // Applies the long range matching to [input], the result is split in blocks of [blockSize] afterwards
+    inline std::vector<uint8_t> encodeLongRange(const uint8_t* input, size_t length, uint32_t blockSize,
+                                                Context& context) {
+        Stats::Measure measure(context.stats, Stats::Stage::LongRange, length, &context.arena);
+
+        std::vector<uint8_t> data(LongRange::encodeBound(length));
+        data.resize(LongRange::encode(input, length, data.data(), blockSize, context.arena));
+        context.arena.reset(); // the hash tables are only needed while matching
+
+        measure.setBytesOut(data.size());
+        return data;
+    }
+
+    // Restores the [originalSize] bytes of the long range matching, returns false if the data is corrupted
+    inline bool decodeLongRange(const uint8_t* data, size_t dataSize, uint8_t* output, uint64_t originalSize,
+                                Context& context) {
+        Stats::Measure measure(context.stats, Stats::Stage::LongRange, dataSize);
+
+        size_t decodedSize = LongRange::decode(data, dataSize, output, originalSize);
+        measure.setBytesOut(isError(decodedSize) ? 0 : decodedSize);
+        return decodedSize == originalSize;
+    }
+
+    inline uint32_t dictionaryId(const Options& options) {
+        return options.dictionary != nullptr ? options.dictionary->id() : Format::NO_DICTIONARY;
+    }
+
+    /**
+     * Compresses [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the compressed size, or INVALID_SIZE if it does not fit
+     */
+    inline size_t compress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity,
+                           const Options& options = Options(), Context& context = Context::forCurrentThread()) {
+
+        uint32_t blockSize = options.blockSize;
+        if (blockSize < Format::MINIMUM_BLOCK_SIZE || blockSize > Format::MAXIMUM_BLOCK_SIZE)
+            return INVALID_SIZE;
+
+        Format::Header header = {0, blockSize, length, dictionaryId(options)};
+        if (!options.longRange)
+            return compressBlocks(input, length, header, output, capacity, options, context);
+
+        header.flags |= Format::FLAG_LONG_RANGE;
+        std::vector<uint8_t> data = encodeLongRange(input, length, blockSize, context);
+        return compressBlocks(data.data(), data.size(), header, output, capacity, options, context);
+    }
+
+    /**
+     * Decompresses the bytes [offset, offset + length) of the data held by the blocks to [output],
+     * only the blocks overlapping the range are decoded <br>
+     * Returns false if one of them is corrupted
+     */
+    inline bool decompressBlocks(const uint8_t* input, const Container& container, uint64_t offset, uint64_t length,
+                                 uint8_t* output, Context& context) {
+
+        const Dictionary* dictionary;
+        if (!findDictionary(container, context, dictionary))
+            return false;
+
+        const std::vector<Format::BlockEntry>& blocks = container.blocks;
+        std::pair<size_t, size_t> range = Format::findBlocks(blocks, offset, length);
+        for (size_t i = range.first; i < range.second; ++i) {
+            const Format::BlockEntry& block = blocks[i];
+
+            // Blocks fully inside the range are decoded directly to the output
+            bool isInsideRange = block.originalOffset >= offset &&
+                                 block.originalOffset + block.originalSize <= offset + length;
+
+            bool isValid;
+            {
+                ScratchArena::Scope scope(context.arena);
+
+                uint8_t* decompressed = isInsideRange ? output + (block.originalOffset - offset)
+                                                      : context.arena.allocate<uint8_t>(block.originalSize);
+
+                isValid = decompressBlock(input + block.compressedOffset, block.compressedSize, decompressed,
+                                          block.originalSize, context, dictionary);
+
+                if (isValid && !isInsideRange) {
+                    uint64_t begin = std::max(offset, block.originalOffset);
+                    uint64_t end = std::min(offset + length, block.originalOffset + block.originalSize);
+                    memcpy(output + (begin - offset), decompressed + (begin - block.originalOffset), end - begin);
+                }
+            }
+            context.arena.reset();
+
+            if (!isValid)
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Decompresses the original bytes [offset, offset + rangeLength) of [input] to [output] which can hold [capacity] bytes,
+     * only the blocks overlapping the range are decoded, unless long range matching was applied <br>
+     * Returns the number of bytes written (less than rangeLength if the range goes past the end),
+     * or INVALID_SIZE if they do not fit or the input is corrupted
+     */
+    inline size_t decompressRange(const uint8_t* input, size_t length, uint64_t offset, uint64_t rangeLength,
+                                  uint8_t* output, size_t capacity, Context& context = Context::forCurrentThread()) {
+
+        Container container;
+        if (!readContainer(input, length, container))
+            return INVALID_SIZE;
+
+        uint64_t originalSize = container.header.originalSize;
+        if (offset >= originalSize)
+            return 0;
+
+        rangeLength = std::min(rangeLength, originalSize - offset);
+        if (rangeLength > capacity)
+            return INVALID_SIZE;
+
+        if ((container.header.flags & Format::FLAG_LONG_RANGE) == 0)
+            return decompressBlocks(input, container, offset, rangeLength, output, context) ? rangeLength : INVALID_SIZE;
+
+        // References may point anywhere before the range, so all the data is decoded
+        std::vector<uint8_t> data(container.footer.dataSize);
+        if (!decompressBlocks(input, container, 0, data.size(), data.data(), context))
+            return INVALID_SIZE;
+
+        // The original size of the header is only trusted once the tokens add up to it
+        if (LongRange::decodedSize(data.data(), data.size()) != originalSize)
+            return INVALID_SIZE;
+
+        bool isWhole = rangeLength == originalSize;
+        std::vector<uint8_t> original(isWhole ? 0 : originalSize);
+        if (!decodeLongRange(data.data(), data.size(), isWhole ? output : original.data(), originalSize, context))
+            return INVALID_SIZE;
+
+        if (!isWhole)
+            memcpy(output, original.data() + offset, rangeLength);
+        return rangeLength;
+    }
+
+    /**
+     * Decompresses [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the original size, or INVALID_SIZE if it does not fit or the input is corrupted
+     */
+    inline size_t decompress(const uint8_t* input, size_t length, uint8_t* output, size_t capacity,
+                             Context& context = Context::forCurrentThread()) {
+
+        size_t originalSize = getDecompressedSize(input, length);
+        if (isError(originalSize) || originalSize > capacity)
+            return INVALID_SIZE;
+
+        return decompressRange(input, length, 0, originalSize, output, capacity, context);
+    }
+
+
+    inline bool compress(const std::string& toBeCompressedFilename, const std::string& outputFilename,
+                         const Options& options = Options(), Context& context = Context::forCurrentThread()) {
+
+        uint32_t blockSize = options.blockSize;
+        if (blockSize < Format::MINIMUM_BLOCK_SIZE || blockSize > Format::MAXIMUM_BLOCK_SIZE)
+            return false;
+
+        std::ifstream input(toBeCompressedFilename, std::ios::in | std::ios::binary);
+        uint64_t originalSize = BinaryIO::getFileSize(input);
+        Format::Header header = {0, blockSize, originalSize, dictionaryId(options)};
+
+        // Long range matching needs the whole file in memory, otherwise only one block is held at a time
+        std::vector<uint8_t> data;
+        uint64_t dataSize = originalSize;
+        if (options.longRange) {
+            std::vector<uint8_t> original(originalSize);
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, originalSize);
+                if (!BinaryIO::read(input, 0, original.data(), originalSize))
+                    return false;
+                measure.setBytesOut(originalSize);
+            }
+
+            data = encodeLongRange(original.data(), originalSize, header.blockSize, context);
+            dataSize = data.size();
+            header.flags |= Format::FLAG_LONG_RANGE;
+        }
+
+        remove(outputFilename.c_str()); // Remove Output File If Exists
+        std::ofstream output(outputFilename, std::ios::out | std::ios::binary);
+
+        size_t bufferSize = std::min(dataSize, (uint64_t) blockSize);
+        std::unique_ptr<uint8_t[]> block(new uint8_t[options.longRange ? 0 : bufferSize]);
+        size_t compressedCapacity = std::max(compressBlockBound(bufferSize, options.dictionary, options.searchIndex),
+                                             Format::HEADER_SIZE);
+        std::unique_ptr<uint8_t[]> compressed(new uint8_t[compressedCapacity]);
+
+        Format::writeHeader(compressed.get(), header);
+        output.write((const char*) compressed.get(), Format::HEADER_SIZE);
+        uint64_t compressedSize = Format::HEADER_SIZE;
+
+        std::vector<Format::BlockEntry> blocks;
+        for (uint64_t offset = 0; offset < dataSize;) {
+            uint32_t blockOriginalSize = std::min(dataSize - offset, (uint64_t) blockSize);
+
+            // A content defined chunk is found in a whole block read at its start, the rest is read again with the next one
+            const uint8_t* blockData = block.get();
+            if (options.longRange) {
+                blockData = data.data() + offset;
+            } else {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, blockOriginalSize);
+                if (!BinaryIO::read(input, offset, block.get(), blockOriginalSize))
+                    return false;
+                measure.setBytesOut(blockOriginalSize);
+            }
+            blockOriginalSize = nextBlockSize(blockData, blockOriginalSize, options, context);
+
+            size_t blockCompressedSize = compressCachedBlock(blockData, blockOriginalSize, compressed.get(),
+                                                             compressBlockBound(blockOriginalSize, options.dictionary,
+                                                                                options.searchIndex),
+                                                             options, context);
+            context.arena.reset();
+
+            if (isError(blockCompressedSize))
+                return false;
+
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, blockCompressedSize);
+                output.write((const char*) compressed.get(), blockCompressedSize);
+                measure.setBytesOut(blockCompressedSize);
+            }
+            blocks.push_back({offset, compressedSize, blockOriginalSize, (uint32_t) blockCompressedSize});
+            compressedSize += blockCompressedSize;
+            offset += blockOriginalSize;
+        }
+
+        Format::Footer footer = {dataSize, compressedSize, (uint32_t) blocks.size()};
+        std::vector<uint8_t> indexAndFooter(Format::indexSize(footer.numberOfBlocks) + Format::FOOTER_SIZE);
+        Format::writeIndex(indexAndFooter.data(), blocks);
+        Format::writeFooter(indexAndFooter.data() + Format::indexSize(footer.numberOfBlocks), footer);
+        output.write((const char*) indexAndFooter.data(), indexAndFooter.size());
+
+        return output.good();
+    }
+
+
+    /**
+     * Decompresses the original bytes [offset, offset + length) of a compressed file whose container is read,
+     * only the blocks overlapping the range are read and decoded, unless long range matching was applied <br>
+     * They are written to [output], or only checked if it is null <br>
+     * Returns false if the file is corrupted
+     */
+    inline bool decompressRange(std::ifstream& input, const Container& container, uint64_t offset, uint64_t length,
+                                std::ostream* output, Context& context) {
+
+        const Dictionary* dictionary;
+        if (!findDictionary(container, context, dictionary))
+            return false;
+
+        uint64_t originalSize = container.header.originalSize;
+        if (offset >= originalSize)
+            return true;
+        length = std::min(length, originalSize - offset);
+
+        // References of the long range matching may point anywhere before the range, so all the data is decoded in memory
+        bool isLongRange = (container.header.flags & Format::FLAG_LONG_RANGE) != 0;
+        uint64_t dataOffset = isLongRange ? 0 : offset;
+        uint64_t dataLength = isLongRange ? container.footer.dataSize : length;
+        std::vector<uint8_t> data(isLongRange ? dataLength : 0);
+
+        std::unique_ptr<uint8_t[]> compressed;
+        std::unique_ptr<uint8_t[]> block(new uint8_t[std::min((uint64_t) container.header.blockSize, container.footer.dataSize)]);
+        size_t compressedCapacity = 0;
+
+        const std::vector<Format::BlockEntry>& blocks = container.blocks;
+        std::pair<size_t, size_t> range = Format::findBlocks(blocks, dataOffset, dataLength);
+        for (size_t i = range.first; i < range.second; ++i) {
+            const Format::BlockEntry& entry = blocks[i];
+
+            if (entry.compressedSize > compressedCapacity) {
+                compressedCapacity = entry.compressedSize;
+                compressed.reset(new uint8_t[compressedCapacity]);
+            }
+
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, entry.compressedSize);
+                if (!BinaryIO::read(input, entry.compressedOffset, compressed.get(), entry.compressedSize))
+                    return false;
+                measure.setBytesOut(entry.compressedSize);
+            }
+
+            bool isValid = decompressBlock(compressed.get(), entry.compressedSize, block.get(), entry.originalSize, context,
+                                           dictionary);
+            context.arena.reset();
+
+            if (!isValid)
+                return false;
+
+            uint64_t begin = std::max(dataOffset, entry.originalOffset);
+            uint64_t end = std::min(dataOffset + dataLength, entry.originalOffset + entry.originalSize);
+            if (isLongRange) {
+                memcpy(data.data() + begin, block.get() + (begin - entry.originalOffset), end - begin);
+            } else if (output != nullptr) {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, end - begin);
+                output->write((const char*) block.get() + (begin - entry.originalOffset), end - begin);
+                measure.setBytesOut(end - begin);
+            }
+        }
+
+        if (isLongRange) {
+            // The original size of the header is only trusted once the tokens add up to it
+            if (LongRange::decodedSize(data.data(), data.size()) != originalSize)
+                return false;
+
+            std::vector<uint8_t> original(originalSize);
+            if (!decodeLongRange(data.data(), data.size(), original.data(), originalSize, context))
+                return false;
+
+            if (output != nullptr) {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, length);
+                output->write((const char*) original.data() + offset, length);
+                measure.setBytesOut(length);
+            }
+        }
+
+        return output == nullptr || output->good();
+    }
+
+    /**
+     * Decompresses the original bytes [offset, offset + length) of a compressed file,
+     * only the blocks overlapping the range are read and decoded, unless long range matching was applied <br>
+     * Returns false if the file is corrupted
+     */
+    inline bool decompressRange(const std::string& toBeDecompressedFilename, const std::string& outputFilename,
+                                uint64_t offset, uint64_t length, Context& context = Context::forCurrentThread()) {
+
+        std::ifstream input(toBeDecompressedFilename, std::ios::in | std::ios::binary);
+        Container container;
+        if (!readContainer(input, container))
+            return false;
+
+        remove(outputFilename.c_str()); // Remove Output File If Exists
+        std::ofstream output(outputFilename, std::ios::out | std::ios::binary);
+        return decompressRange(input, container, offset, length, &output, context);
+    }
+
+    /**
+     * Decompresses a compressed file in memory and checks the checksum of each block, nothing is written <br>
+     * Returns false if it is not compressed by this version (files of the original format have no checksums)
+     * or it is corrupted
+     */
+    inline bool test(const std::string& compressedFilename, Context& context = Context::forCurrentThread()) {
+        std::ifstream input(compressedFilename, std::ios::in | std::ios::binary);
+        Container container;
+        if (!readContainer(input, container))
+            return false;
+
+        return decompressRange(input, container, 0, container.header.originalSize, nullptr, context);
+    }
+
+
+    // Longest pattern of a search, so a match spans two blocks at most
+    // (content defined chunks are at least a quarter of a block, only the last block can be shorter)
+    const size_t MAXIMUM_PATTERN_SIZE = Format::MINIMUM_BLOCK_SIZE / 4;
+
+    struct Match {
+        uint64_t offset;        // of the pattern in the original data
+        uint64_t contextOffset; // of the context in the original data
+        std::string context;    // the pattern with up to contextSize bytes around it, in its blocks
+    };
+
+    // Adds the occurrences of [pattern] starting in [text] at [first, last) to [matches], [text] is at [offset] of the data
+    inline void findInText(const std::string& text, uint64_t offset, size_t first, size_t last,
+                           const std::string& pattern, size_t contextSize, std::vector<Match>& matches) {
+        for (size_t start = first; start < last && start + pattern.size() <= text.size(); ++start) {
+            if (text.compare(start, pattern.size(), pattern) != 0)
+                continue;
+
+            size_t contextBegin = start >= contextSize ? start - contextSize : 0;
+            size_t contextEnd = std::min(text.size(), start + pattern.size() + contextSize);
+            matches.push_back({offset + start, offset + contextBegin, text.substr(contextBegin, contextEnd - contextBegin)});
+        }
     }
 
+    /**
+     * Text of a block for a search, read through the FM-index of a searchable block or decompressed for the others
+     */
+    class SearchedBlock {
+        Context& context;
+        const Dictionary* dictionary;
+        std::vector<uint8_t> compressed;
+        std::vector<uint8_t> decompressed;
+        FMIndex index;
+        bool isIndexed = false;
+
+    public:
+        SearchedBlock(Context& context, const Dictionary* dictionary)
+                : context(context), dictionary(dictionary),
+                  index(context.mtfDecoder, context.lzwDecoder, dictionary != nullptr ? &dictionary->primer() : nullptr) {}
+
+        // Reads the block of [entry], and decompresses it unless it is searchable. Returns false if it is corrupted
+        bool load(std::ifstream& input, const Format::BlockEntry& entry) {
+            compressed.resize(entry.compressedSize);
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::IO, entry.compressedSize);
+                if (!BinaryIO::read(input, entry.compressedOffset, compressed.data(), compressed.size()))
+                    return false;
+                measure.setBytesOut(entry.compressedSize);
+            }
+
+            uint8_t blockFlags = compressed[0];
+            isIndexed = blockFlags == Format::PIPELINE_SEARCHABLE << Format::BLOCK_PIPELINE_SHIFT; // without transforms
+            if (!isIndexed)
+                return decompress(entry.originalSize);
+
+            Stats::Measure measure(context.stats, Stats::Stage::FMIndex, entry.compressedSize);
+            return index.open(compressed.data() + Format::BLOCK_HEADER_SIZE, compressed.size() - Format::BLOCK_HEADER_SIZE,
+                              entry.originalSize, BinaryIO::loadUint32(compressed.data() + 1));
+        }
+
+        /**
+         * Positions of the occurrences of [pattern] in the block, in increasing order <br>
+         * Returns false if the block is corrupted
+         */
+        bool find(const std::string& pattern, std::vector<uint32_t>& positions) {
+            positions.clear();
+            if (isIndexed) {
+                Stats::Measure measure(context.stats, Stats::Stage::FMIndex, pattern.size());
+                uint32_t first, last;
+                if (!index.findRows((const uint8_t*) pattern.data(), pattern.size(), first, last))
+                    return false;
+
+                // Each match is located in sampling rate steps at most, decompressing is faster when there are many of them
+                if ((uint64_t) (last - first) * index.samplingRate() <= index.length()) {
+                    for (uint32_t row = first; row < last; ++row) {
+                        uint32_t position;
+                        if (!index.locate(row, position))
+                            return false;
+                        positions.push_back(position);
+                    }
+
+                    std::sort(positions.begin(), positions.end());
+                    measure.setBytesOut(positions.size() * sizeof(uint32_t));
+                    return true;
+                }
+
+                if (!decompress(index.length()))
+                    return false;
+            }
+
+            const uint8_t* begin = decompressed.data();
+            const uint8_t* end = begin + decompressed.size();
+            for (const uint8_t* match = std::search(begin, end, pattern.begin(), pattern.end()); match != end;
+                 match = std::search(match + 1, end, pattern.begin(), pattern.end()))
+                positions.push_back(match - begin);
+            return true;
+        }
+
+        // Appends the bytes [begin, end) of the block to [text], returns false if the block is corrupted
+        bool extract(uint32_t begin, uint32_t end, std::string& text) {
+            size_t size = text.size();
+            text.resize(size + (end - begin));
+            if (isIndexed)
+                return index.extract(begin, end, (uint8_t*) &text[size]);
+
+            memcpy(&text[size], decompressed.data() + begin, end - begin);
+            return true;
+        }
+
+    private:
+
+        // The whole block, which checks its checksum
+        bool decompress(uint32_t originalSize) {
+            isIndexed = false;
+            decompressed.resize(originalSize);
+            bool isValid = decompressBlock(compressed.data(), compressed.size(), decompressed.data(), originalSize,
+                                           context, dictionary);
+            context.arena.reset();
+            return isValid;
+        }
+    };
+
+    /**
+     * Adds the occurrences of [pattern] in [blocks] of [input] to [matches] by increasing offset,
+     * with up to [contextSize] bytes around them <br>
+     * The backward search of a searchable block only decodes the segments it reads, so a block without any match is
+     * skipped after decoding 2 segments per byte of the pattern at most, the others are decompressed <br>
+     * Returns false if the pattern is empty or longer than MAXIMUM_PATTERN_SIZE, or a block is corrupted
+     */
+    inline bool searchBlocks(std::ifstream& input, const std::vector<Format::BlockEntry>& blocks,
+                             const Dictionary* dictionary, const std::string& pattern, size_t contextSize,
+                             std::vector<Match>& matches, Context& context) {
+        if (pattern.empty() || pattern.size() > MAXIMUM_PATTERN_SIZE)
+            return false;
+
+        // The end of the previous block, where the matches spanning two blocks start
+        size_t overlap = pattern.size() - 1 + contextSize;
+        std::string tail;
+        uint64_t tailOffset = 0;
+
+        SearchedBlock block(context, dictionary);
+        std::vector<uint32_t> positions;
+        for (const Format::BlockEntry& entry : blocks) {
+            if (!block.load(input, entry))
+                return false;
+
+            uint32_t headSize = (uint32_t) std::min(overlap, (size_t) entry.originalSize);
+            if (!tail.empty()) {
+                std::string joined = tail;
+                if (!block.extract(0, headSize, joined))
+                    return false;
+
+                size_t first = tail.size() - std::min(tail.size(), pattern.size() - 1);
+                findInText(joined, tailOffset, first, tail.size(), pattern, contextSize, matches);
+            }
+
+            if (!block.find(pattern, positions))
+                return false;
+
+            for (uint32_t position : positions) {
+                uint32_t contextBegin = position >= contextSize ? position - (uint32_t) contextSize : 0;
+                uint32_t contextEnd = (uint32_t) std::min((uint64_t) entry.originalSize,
+                                                          (uint64_t) position + pattern.size() + contextSize);
+
+                Match match = {entry.originalOffset + position, entry.originalOffset + contextBegin, std::string()};
+                if (!block.extract(contextBegin, contextEnd, match.context))
+                    return false;
+                matches.push_back(std::move(match));
+            }
+
+            uint32_t tailSize = headSize;
+            tail.clear();
+            if (pattern.size() > 1 && !block.extract(entry.originalSize - tailSize, entry.originalSize, tail))
+                return false;
+            tailOffset = entry.originalOffset + entry.originalSize - tailSize;
+        }
+
+        return true;
+    }
+
+    /**
+     * Finds the occurrences of [pattern] in a compressed file, as searchBlocks does <br>
+     * The blocks of a file with long range matching do not hold the original bytes, it is decompressed in memory instead <br>
+     * Returns false if the pattern is not valid, the file is not compressed by this version or it is corrupted
+     */
+    inline bool search(const std::string& compressedFilename, const std::string& pattern, size_t contextSize,
+                       std::vector<Match>& matches, Context& context = Context::forCurrentThread()) {
+        std::ifstream input(compressedFilename, std::ios::in | std::ios::binary);
+        Container container;
+        const Dictionary* dictionary;
+        if (!readContainer(input, container) || !findDictionary(container, context, dictionary))
+            return false;
+
+        if ((container.header.flags & Format::FLAG_LONG_RANGE) == 0)
+            return searchBlocks(input, container.blocks, dictionary, pattern, contextSize, matches, context);
+
+        std::ostringstream original;
+        if (pattern.empty() || pattern.size() > MAXIMUM_PATTERN_SIZE ||
+            !decompressRange(input, container, 0, container.header.originalSize, &original, context))
+            return false;
+
+        std::string text = original.str();
+        findInText(text, 0, 0, text.size(), pattern, contextSize, matches);
+        return true;
+    }
+
+
+    inline bool decompress(const std::string& toBeDecompressedFilename, const std::string& outputFilename,
+                           Context& context = Context::forCurrentThread()) {
+
+        std::ifstream input(toBeDecompressedFilename, std::ios::in | std::ios::binary);
+        uint8_t magic[sizeof(Format::MAGIC)];
+        if (!BinaryIO::read(input, 0, magic, sizeof(magic)) || !Format::hasMagic(magic, sizeof(magic))) {
+            // Original format, each stage reads the output file of the previous one
+            // so their measures include the I/O
+            auto fileSize = [&context](const std::string& filename) -> uint64_t {
+                return context.stats != nullptr ? BinaryIO::getFileSize(filename) : 0; // not opened when not measured
+            };
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::LZW, fileSize(toBeDecompressedFilename));
+                LZW::decode(toBeDecompressedFilename, outputFilename);
+                measure.setBytesOut(fileSize(outputFilename));
+            }
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::MTF, fileSize(outputFilename));
+                MTF::decode(outputFilename, outputFilename); // same filename will makes it write output to the same file
+                measure.setBytesOut(fileSize(outputFilename));
+            }
+            {
+                Stats::Measure measure(context.stats, Stats::Stage::BWT, fileSize(outputFilename));
+                BWT::decode(outputFilename, outputFilename); // same filename will makes it write output to the same file
+                measure.setBytesOut(fileSize(outputFilename));
+            }
+
+            // The file stages allocate from the arena of the thread instead of the one of the context
+            ScratchArena::forCurrentThread().reset();
+            return true;
+        }
 
-    void decompress(const std::string& toBeDecompressedFilename, const std::string& outputFilename) {
-        LZW::decode(toBeDecompressedFilename, outputFilename);
-        MTF::decode(outputFilename, outputFilename); // same filename will makes it write output to the same file
-        BWT::decode(outputFilename, outputFilename); // same filename will makes it write output to the same file
+        return decompressRange(toBeDecompressedFilename, outputFilename, 0, UINT64_MAX, context);
     }
 
 }
@@ -0,0 +1,697 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Compressor.h"
+#include "../Utils/BinaryIO.h"
+#include "../Utils/FileSystem.h"
+#include "../Utils/ThreadPool.h"
+
+/**
+ * Long running compression service listening on a Unix domain socket (not available on Windows) <br>
+ * Its workers and their contexts live as long as the daemon and are warmed up before the first connection,
+ * so a job only pays the compression itself, without the process start nor the first allocations of the stages
+ *
+ * @Protocol
+ * Request: Kind (1 Byte), Flags (1 Byte), Block Size (4 Bytes, LE, 0 for the one of the daemon),
+ * Numeric Filter (2 Bytes, as stored by NumericTransform::storeFilter,
+ * 0 for the one of the daemon, or for none with FLAG_NO_NUMERIC),
+ * Payload Size (8 Bytes, LE), then the payload <br>
+ * Response: Status (1 Byte), Payload Size (8 Bytes, LE), then the payload <br>
+ * A connection can send many requests, each one is answered before the next one is read
+ */
+namespace Daemon {
+
+    enum Kind : uint8_t {
+        COMPRESS = 1,        // Payload: the data, response: the compressed data
+        DECOMPRESS = 2,      // Payload: the compressed data, response: the data
+        COMPRESS_FILE = 3,   // Payload: absolute input path, '\0', absolute output path, response: empty
+        DECOMPRESS_FILE = 4, // Same as COMPRESS_FILE
+        METRICS = 5,         // Response: the metrics of the daemon in JSON
+        STOP = 6             // Stops accepting connections, the jobs already running are finished
+    };
+
+    enum Status : uint8_t {
+        OK = 0,
+        FAILED = 1,     // The output does not fit, the input is corrupted or a file can not be read or written
+        BAD_REQUEST = 2
+    };
+
+    // Added to the options of the daemon
+    const uint8_t FLAG_LONG_RANGE = 1;
+    const uint8_t FLAG_RLE = 2;
+    const uint8_t FLAG_ADAPTIVE = 4;
+    const uint8_t FLAG_SEARCH_INDEX = 8;
+    const uint8_t FLAG_WORDS = 16;
+
+    // Compresses without a numeric filter even if the daemon has one, a filter of 0 keeps the one of the daemon
+    const uint8_t FLAG_NO_NUMERIC = 32;
+
+    const uint32_t REQUEST_HEADER_SIZE = 1 + 1 + 4 + NumericTransform::FILTER_SIZE + 8;
+    const uint32_t RESPONSE_HEADER_SIZE = 1 + 8;
+
+    // Larger inputs are sent as files
+    const uint64_t MAXIMUM_PAYLOAD_SIZE = 1ull << 30;
+
+    // Connections served at once, each one buffers a request and its response, the others wait to be accepted
+    const size_t DEFAULT_MAXIMUM_CONNECTIONS = 16;
+
+    // Size of the compression run by each worker before the first connection
+    const size_t DEFAULT_WARM_UP_SIZE = 1u << 20;
+
+    struct Request {
+        uint8_t kind = 0;
+        uint8_t flags = 0;
+        uint32_t blockSize = 0;
+        NumericTransform::Filter numericFilter; // Operation::DETECT is sent as well
+        std::vector<uint8_t> payload;
+    };
+
+    struct Response {
+        uint8_t status = OK;
+        std::vector<uint8_t> payload;
+    };
+
+#ifdef MSG_NOSIGNAL
+    const int SEND_FLAGS = MSG_NOSIGNAL; // a closed connection must not kill the process with SIGPIPE
+#else
+    const int SEND_FLAGS = 0;
+#endif
+
+    inline bool readAll(int socket, uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t count = recv(socket, data, length, 0);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+
+            data += count;
+            length -= count;
+        }
+        return true;
+    }
+
+    inline bool writeAll(int socket, const uint8_t* data, size_t length) {
+        while (length > 0) {
+            ssize_t count = send(socket, data, length, SEND_FLAGS);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+
+            data += count;
+            length -= count;
+        }
+        return true;
+    }
+
+    inline bool writeRequest(int socket, const Request& request) {
+        uint8_t header[REQUEST_HEADER_SIZE];
+        header[0] = request.kind;
+        header[1] = request.flags;
+        BinaryIO::storeUint32(header + 2, request.blockSize);
+        NumericTransform::storeFilter(header + 6, request.numericFilter);
+        BinaryIO::storeUint64(header + 6 + NumericTransform::FILTER_SIZE, request.payload.size());
+        return writeAll(socket, header, sizeof(header)) &&
+               writeAll(socket, request.payload.data(), request.payload.size());
+    }
+
+    // Returns false when the connection is closed or the payload is too large
+    inline bool readRequest(int socket, Request& request) {
+        uint8_t header[REQUEST_HEADER_SIZE];
+        if (!readAll(socket, header, sizeof(header)))
+            return false;
+
+        request.kind = header[0];
+        request.flags = header[1];
+        request.blockSize = BinaryIO::loadUint32(header + 2);
+        // NONE and DETECT are not valid filters of a block, the job checks the filter
+        NumericTransform::loadFilter(header + 6, request.numericFilter);
+        uint64_t payloadSize = BinaryIO::loadUint64(header + 6 + NumericTransform::FILTER_SIZE);
+        if (payloadSize > MAXIMUM_PAYLOAD_SIZE)
+            return false;
+
+        request.payload.resize(payloadSize);
+        return readAll(socket, request.payload.data(), payloadSize);
+    }
+
+    inline bool writeResponse(int socket, const Response& response) {
+        uint8_t header[RESPONSE_HEADER_SIZE];
+        header[0] = response.status;
+        BinaryIO::storeUint64(header + 1, response.payload.size());
+        return writeAll(socket, header, sizeof(header)) &&
+               writeAll(socket, response.payload.data(), response.payload.size());
+    }
+
+    inline bool readResponse(int socket, Response& response) {
+        uint8_t header[RESPONSE_HEADER_SIZE];
+        if (!readAll(socket, header, sizeof(header)))
+            return false;
+
+        response.status = header[0];
+        uint64_t payloadSize = BinaryIO::loadUint64(header + 1);
+        if (payloadSize > MAXIMUM_PAYLOAD_SIZE)
+            return false;
+
+        response.payload.resize(payloadSize);
+        return readAll(socket, response.payload.data(), payloadSize);
+    }
+
+    inline bool makeAddress(const std::string& socketPath, sockaddr_un& address) {
+        memset(&address, 0, sizeof(address));
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path))
+            return false;
+
+        address.sun_family = AF_UNIX;
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        return true;
+    }
+
+    // Payload of the file requests
+    inline std::vector<uint8_t> filePayload(const std::string& inputFilename, const std::string& outputFilename) {
+        std::vector<uint8_t> payload(inputFilename.begin(), inputFilename.end());
+        payload.push_back('\0');
+        payload.insert(payload.end(), outputFilename.begin(), outputFilename.end());
+        return payload;
+    }
+
+    inline bool parseFilePayload(const std::vector<uint8_t>& payload, std::string& inputFilename,
+                                 std::string& outputFilename) {
+        auto separator = std::find(payload.begin(), payload.end(), '\0');
+        if (separator == payload.end() || separator == payload.begin() || separator + 1 == payload.end() ||
+            std::find(separator + 1, payload.end(), '\0') != payload.end())
+            return false;
+
+        inputFilename.assign(payload.begin(), separator);
+        outputFilename.assign(separator + 1, payload.end());
+        return inputFilename[0] == '/' && outputFilename[0] == '/'; // the daemon has its own working directory
+    }
+
+    /**
+     * Counters of the jobs, sent to METRICS requests <br>
+     * Latencies are counted in buckets of powers of 2 microseconds, the percentiles are interpolated linearly in them
+     */
+    class Metrics {
+
+        static const int NUMBER_OF_BUCKETS = 40;
+
+        mutable std::mutex mutex;
+        std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        uint64_t connections = 0;
+        uint64_t queued = 0;
+        uint64_t running = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t rejected = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        double queueSeconds = 0;
+        double maximumQueueSeconds = 0;
+        double serviceSeconds = 0;
+        double maximumServiceSeconds = 0;
+        double maximumLatencySeconds = 0;
+        uint64_t latencyBuckets[NUMBER_OF_BUCKETS] = {};
+
+    public:
+
+        void connectionOpened() {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections++;
+        }
+
+        void connectionClosed() {
+            std::lock_guard<std::mutex> lock(mutex);
+            connections--;
+        }
+
+        void jobRejected() {
+            std::lock_guard<std::mutex> lock(mutex);
+            rejected++;
+        }
+
+        void jobQueued() {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued++;
+        }
+
+        // [seconds] spent waiting for a worker
+        void jobStarted(double seconds) {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued--;
+            running++;
+            queueSeconds += seconds;
+            maximumQueueSeconds = std::max(maximumQueueSeconds, seconds);
+        }
+
+        // [seconds] spent by the worker, [latencySeconds] from the request to the response
+        void jobFinished(bool isSuccessful, double seconds, double latencySeconds, uint64_t in, uint64_t out) {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            (isSuccessful ? completed : failed)++;
+            bytesIn += in;
+            bytesOut += out;
+            serviceSeconds += seconds;
+            maximumServiceSeconds = std::max(maximumServiceSeconds, seconds);
+            maximumLatencySeconds = std::max(maximumLatencySeconds, latencySeconds);
+
+            int bucket = 0;
+            for (uint64_t microseconds = latencySeconds * 1e6; microseconds > 0 && bucket + 1 < NUMBER_OF_BUCKETS;
+                 microseconds >>= 1)
+                bucket++;
+            latencyBuckets[bucket]++;
+        }
+
+        std::string toJson(size_t numberOfWorkers) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            uint64_t finished = completed + failed;
+
+            std::ostringstream json;
+            json << "{\n  \"uptime_seconds\": "
+                 << std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count()
+                 << ",\n  \"workers\": " << numberOfWorkers
+                 << ",\n  \"connections\": " << connections
+                 << ",\n  \"queued_jobs\": " << queued
+                 << ",\n  \"running_jobs\": " << running
+                 << ",\n  \"completed_jobs\": " << completed
+                 << ",\n  \"failed_jobs\": " << failed
+                 << ",\n  \"rejected_requests\": " << rejected
+                 << ",\n  \"bytes_in\": " << bytesIn
+                 << ",\n  \"bytes_out\": " << bytesOut
+                 << ",\n  \"average_queue_seconds\": " << (finished > 0 ? queueSeconds / finished : 0)
+                 << ",\n  \"maximum_queue_seconds\": " << maximumQueueSeconds
+                 << ",\n  \"average_service_seconds\": " << (finished > 0 ? serviceSeconds / finished : 0)
+                 << ",\n  \"maximum_service_seconds\": " << maximumServiceSeconds
+                 << ",\n  \"latency_p50_seconds\": " << latencyPercentile(0.5)
+                 << ",\n  \"latency_p90_seconds\": " << latencyPercentile(0.9)
+                 << ",\n  \"latency_p99_seconds\": " << latencyPercentile(0.99) << "\n}\n";
+            return json.str();
+        }
+
+    private:
+
+        // Called with the lock held, the bucket b > 0 holds the latencies of [2^(b-1), 2^b) microseconds,
+        // the interpolation in the bucket of the largest one may go past it
+        double latencyPercentile(double fraction) const {
+            uint64_t total = 0;
+            for (uint64_t count : latencyBuckets)
+                total += count;
+            if (total == 0)
+                return 0;
+
+            double rank = fraction * total;
+            uint64_t seen = 0;
+            for (int bucket = 0; bucket < NUMBER_OF_BUCKETS; ++bucket) {
+                uint64_t count = latencyBuckets[bucket];
+                if (seen + count > rank) {
+                    double lower = bucket == 0 ? 0 : (double) (1ull << (bucket - 1));
+                    double upper = (double) (1ull << bucket);
+                    return std::min((lower + (upper - lower) * (rank - seen) / count) * 1e-6, maximumLatencySeconds);
+                }
+                seen += count;
+            }
+            return maximumLatencySeconds;
+        }
+
+    };
+
+    /**
+     * The daemon, jobs of all the connections are queued to one pool of workers <br>
+     * Each connection has a thread reading its requests, which only waits for the workers <br>
+     * The connections beyond the maximum wait in the backlog of the socket until one is closed,
+     * so the payloads in memory are bounded
+     */
+    class Server {
+
+        struct Connection {
+            int socket = -1;
+            std::thread thread;
+            std::atomic<bool> isFinished{false};
+        };
+
+        std::string socketPath;
+        Compressor::Options options;
+        ThreadPool workers;
+        Metrics metrics;
+        int listener = -1;
+        std::atomic<bool> isStopping{false};
+        std::list<Connection> connections; // only used by the thread running run()
+        size_t maximumConnections;
+
+    public:
+
+        /**
+         * [options] are the defaults of the jobs, its dictionary is also used to decompress <br>
+         * The chunk cache is not used, its counters are not shared between threads
+         */
+        Server(const std::string& socketPath, const Compressor::Options& options,
+               size_t numberOfThreads = ThreadPool::defaultNumberOfThreads(),
+               size_t maximumConnections = DEFAULT_MAXIMUM_CONNECTIONS)
+                : socketPath(socketPath), options(options), workers(numberOfThreads),
+                  maximumConnections(std::max<size_t>(maximumConnections, 1)) {
+            this->options.chunkCache = nullptr;
+        }
+
+        ~Server() {
+            if (listener >= 0) {
+                close(listener);
+                unlink(socketPath.c_str());
+            }
+        }
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        /**
+         * Creates the socket, only accessible by the current user since jobs read and write its files <br>
+         * A socket file left by a daemon which is not running anymore is replaced <br>
+         * Returns false if the path is too long, can not be created or another daemon listens on it
+         */
+        bool listen() {
+            sockaddr_un address;
+            if (!makeAddress(socketPath, address))
+                return false;
+
+            if (FileSystem::exists(socketPath)) {
+                int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+                bool isInUse = probe >= 0 && connect(probe, (const sockaddr*) &address, sizeof(address)) == 0;
+                if (probe >= 0)
+                    close(probe);
+                if (isInUse)
+                    return false;
+                unlink(socketPath.c_str());
+            }
+
+            listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listener < 0)
+                return false;
+
+            mode_t previousMask = umask(0077);
+            bool isBound = bind(listener, (const sockaddr*) &address, sizeof(address)) == 0;
+            umask(previousMask);
+
+            if (!isBound || ::listen(listener, SOMAXCONN) != 0) {
+                close(listener);
+                listener = -1;
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * Compresses and decompresses [size] bytes on every worker, so the scratch memory of their contexts
+         * is allocated before the first job (it keeps growing if larger blocks come later)
+         */
+        void warmUp(size_t size = DEFAULT_WARM_UP_SIZE) {
+            // Words of a small vocabulary, the LZW dictionaries grow as on text
+            std::vector<uint8_t> data(size);
+            uint32_t state = 1;
+            for (uint8_t& byte : data) {
+                state = state * 1103515245u + 12345u;
+                byte = (state >> 16) % 7 == 0 ? ' ' : 'a' + (state >> 20) % 8;
+            }
+
+            // Every task waits until all of them started, so each worker runs exactly one
+            std::mutex mutex;
+            std::condition_variable hasStarted;
+            size_t numberOfStarted = 0;
+
+            std::vector<std::future<void>> tasks;
+            for (size_t i = 0; i < workers.size(); ++i) {
+                tasks.push_back(workers.submit([&]() {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        numberOfStarted++;
+                        hasStarted.notify_all();
+                        hasStarted.wait(lock, [&]() { return numberOfStarted == workers.size(); });
+                    }
+
+                    Compressor::Context& context = Compressor::Context::forCurrentThread();
+                    context.dictionary = options.dictionary;
+
+                    std::vector<uint8_t> compressed(Compressor::compressBound(size, options.blockSize, options.dictionary,
+                                                                              options.searchIndex));
+                    size_t compressedSize = Compressor::compress(data.data(), size, compressed.data(), compressed.size(),
+                                                                 options, context);
+                    std::vector<uint8_t> decompressed(size);
+                    if (!Compressor::isError(compressedSize))
+                        Compressor::decompress(compressed.data(), compressedSize, decompressed.data(), size, context);
+                }));
+            }
+
+            for (std::future<void>& task : tasks)
+                task.get();
+        }
+
+        /**
+         * Accepts connections until a STOP request, then waits for their running jobs
+         */
+        void run() {
+            while (!isStopping) {
+                // Wakes up regularly to see a STOP, and the closed connections when at the maximum
+                closeFinishedConnections();
+                pollfd listening = {listener, POLLIN, 0};
+                int numberOfReady = connections.size() < maximumConnections ? poll(&listening, 1, 100)
+                                                                             : poll(nullptr, 0, 10);
+                if (numberOfReady <= 0)
+                    continue;
+
+                int client = accept(listener, nullptr, nullptr);
+                if (client < 0)
+                    continue;
+
+                connections.emplace_back();
+                Connection& connection = connections.back();
+                connection.socket = client;
+                connection.thread = std::thread([this, &connection]() {
+                    serve(connection.socket);
+                    connection.isFinished = true;
+                });
+            }
+
+            // Connections waiting for their next request see the end of the stream
+            for (Connection& connection : connections)
+                shutdown(connection.socket, SHUT_RD);
+            for (Connection& connection : connections) {
+                connection.thread.join();
+                close(connection.socket);
+            }
+            connections.clear();
+        }
+
+    private:
+
+        void closeFinishedConnections() {
+            for (auto connection = connections.begin(); connection != connections.end();) {
+                if (connection->isFinished) {
+                    connection->thread.join();
+                    close(connection->socket);
+                    connection = connections.erase(connection);
+                } else {
+                    ++connection;
+                }
+            }
+        }
+
+        void serve(int socket) {
+            metrics.connectionOpened();
+
+            Request request;
+            while (!isStopping && readRequest(socket, request)) {
+                Response response = handle(request);
+                if (!writeResponse(socket, response) || request.kind == STOP)
+                    break;
+            }
+
+            metrics.connectionClosed();
+        }
+
+        Response handle(const Request& request) {
+            Response response;
+            switch (request.kind) {
+                case METRICS: {
+                    std::string json = metrics.toJson(workers.size());
+                    response.payload.assign(json.begin(), json.end());
+                    return response;
+                }
+                case STOP:
+                    isStopping = true;
+                    return response;
+                case COMPRESS:
+                case DECOMPRESS:
+                case COMPRESS_FILE:
+                case DECOMPRESS_FILE:
+                    break;
+                default:
+                    metrics.jobRejected();
+                    response.status = BAD_REQUEST;
+                    return response;
+            }
+
+            Compressor::Options jobOptions = options;
+            if (request.blockSize != 0)
+                jobOptions.blockSize = request.blockSize;
+            jobOptions.longRange |= (request.flags & FLAG_LONG_RANGE) != 0;
+            jobOptions.runLength |= (request.flags & FLAG_RLE) != 0;
+            jobOptions.adaptive |= (request.flags & FLAG_ADAPTIVE) != 0;
+            jobOptions.searchIndex |= (request.flags & FLAG_SEARCH_INDEX) != 0;
+            jobOptions.wordTransform |= (request.flags & FLAG_WORDS) != 0;
+
+            // The numeric filter of the request replaces the one of the daemon
+            NumericTransform::Operation numericOperation = request.numericFilter.operation;
+            bool isValidFilter = numericOperation == NumericTransform::Operation::NONE ||
+                                 numericOperation == NumericTransform::Operation::DETECT ||
+                                 NumericTransform::isValid(request.numericFilter);
+            if ((request.flags & FLAG_NO_NUMERIC) != 0)
+                jobOptions.numericFilter = NumericTransform::Filter();
+            else if (numericOperation != NumericTransform::Operation::NONE)
+                jobOptions.numericFilter = request.numericFilter;
+
+            std::string inputFilename, outputFilename;
+            bool isFileRequest = request.kind == COMPRESS_FILE || request.kind == DECOMPRESS_FILE;
+            if (jobOptions.blockSize < Format::MINIMUM_BLOCK_SIZE || jobOptions.blockSize > Format::MAXIMUM_BLOCK_SIZE ||
+                !isValidFilter || (isFileRequest && !parseFilePayload(request.payload, inputFilename, outputFilename))) {
+                metrics.jobRejected();
+                response.status = BAD_REQUEST;
+                return response;
+            }
+
+            auto queuedTime = std::chrono::steady_clock::now();
+            metrics.jobQueued();
+            return workers.submit([&]() {
+                auto startTime = std::chrono::steady_clock::now();
+                metrics.jobStarted(std::chrono::duration<double>(startTime - queuedTime).count());
+
+                Response jobResponse;
+                // The size of a missing file is -1
+                int64_t inputSize = isFileRequest ? BinaryIO::getFileSize(inputFilename)
+                                                  : (int64_t) request.payload.size();
+                uint64_t bytesIn = std::max<int64_t>(inputSize, 0);
+                try {
+                    bool isSuccessful = isFileRequest ? runFileJob(request.kind, inputFilename, outputFilename, jobOptions)
+                                                      : runJob(request.kind, request.payload, jobOptions, jobResponse.payload);
+                    if (!isSuccessful)
+                        jobResponse.status = FAILED;
+                } catch (const std::exception&) {
+                    jobResponse.status = FAILED; // out of memory, a job must not stop the daemon
+                }
+                if (jobResponse.status != OK)
+                    jobResponse.payload.clear();
+
+                auto endTime = std::chrono::steady_clock::now();
+                int64_t outputSize = isFileRequest ? BinaryIO::getFileSize(outputFilename)
+                                                   : (int64_t) jobResponse.payload.size();
+                uint64_t bytesOut = std::max<int64_t>(outputSize, 0);
+                metrics.jobFinished(jobResponse.status == OK, std::chrono::duration<double>(endTime - startTime).count(),
+                                    std::chrono::duration<double>(endTime - queuedTime).count(),
+                                    bytesIn, jobResponse.status == OK ? bytesOut : 0);
+                return jobResponse;
+            }).get();
+        }
+
+        // Runs on a worker, with its context
+        bool runJob(uint8_t kind, const std::vector<uint8_t>& input, const Compressor::Options& jobOptions,
+                    std::vector<uint8_t>& output) {
+            Compressor::Context& context = Compressor::Context::forCurrentThread();
+            context.dictionary = options.dictionary;
+
+            if (kind == COMPRESS) {
+                output.resize(Compressor::compressBound(input.size(), jobOptions.blockSize, jobOptions.dictionary,
+                                                        jobOptions.searchIndex));
+                size_t compressedSize = Compressor::compress(input.data(), input.size(), output.data(), output.size(),
+                                                             jobOptions, context);
+                if (Compressor::isError(compressedSize))
+                    return false;
+                output.resize(compressedSize);
+                return true;
+            }
+
+            size_t originalSize = Compressor::getDecompressedSize(input.data(), input.size());
+            if (Compressor::isError(originalSize) || originalSize > MAXIMUM_PAYLOAD_SIZE)
+                return false;
+
+            output.resize(originalSize);
+            return !Compressor::isError(Compressor::decompress(input.data(), input.size(), output.data(), output.size(),
+                                                               context));
+        }
+
+        bool runFileJob(uint8_t kind, const std::string& inputFilename, const std::string& outputFilename,
+                        const Compressor::Options& jobOptions) {
+            Compressor::Context& context = Compressor::Context::forCurrentThread();
+            context.dictionary = options.dictionary;
+
+            if (kind == COMPRESS_FILE)
+                return BinaryIO::doesFileExist(inputFilename) &&
+                       Compressor::compress(inputFilename, outputFilename, jobOptions, context);
+
+            // The original format has no checks, a file which is not compressed could crash the daemon
+            std::ifstream input(inputFilename, std::ios::in | std::ios::binary);
+            uint8_t magic[sizeof(Format::MAGIC)];
+            return BinaryIO::read(input, 0, magic, sizeof(magic)) && Format::hasMagic(magic, sizeof(magic)) &&
+                   Compressor::decompress(inputFilename, outputFilename, context);
+        }
+
+    };
+
+    /**
+     * Connection to a daemon, requests are answered one at a time
+     */
+    class Client {
+
+        int connection = -1;
+
+    public:
+
+        Client() = default;
+
+        ~Client() {
+            if (connection >= 0)
+                close(connection);
+        }
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        // Returns false if no daemon listens on [socketPath]
+        bool connect(const std::string& socketPath) {
+            sockaddr_un address;
+            if (!makeAddress(socketPath, address))
+                return false;
+
+            connection = socket(AF_UNIX, SOCK_STREAM, 0);
+            return connection >= 0 && ::connect(connection, (const sockaddr*) &address, sizeof(address)) == 0;
+        }
+
+        // Returns false if the connection is lost, the result of the request is in the status of [response]
+        bool call(const Request& request, Response& response) {
+            return connection >= 0 && writeRequest(connection, request) && readResponse(connection, response);
+        }
+
+    };
+
+}
+
+#endif //_WIN32
+
+#endif //DAEMON_H
@@ -0,0 +1,107 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Format.h"
+#include "LZW/LZW.h"
+#include "../Utils/BinaryIO.h"
+
+/**
+ * Dictionary trained on samples of small inputs of one kind (messages, records, ...), see Compressor::trainDictionary <br>
+ * Its content is the MTF output of the samples, the LZW of every block starts with the words of this content
+ * instead of the single bytes only, so inputs of a few KB do not spend most of their codes learning them
+ *
+ * @File_Format
+ * Magic Number "CMPD" (4 Bytes), Version (1 Byte), ID (4 Bytes, LE), then the content
+ */
+class Dictionary {
+
+    static const uint8_t VERSION = 1;
+    static const uint32_t HEADER_SIZE = 4 + 1 + 4;
+
+    uint32_t dictionaryId = Format::NO_DICTIONARY;
+    std::vector<uint8_t> dictionaryContent;
+    LZW::Primer lzwPrimer;
+
+public:
+
+    // Bigger dictionaries prime more words but make every code wider
+    static const uint32_t DEFAULT_SIZE = 64u << 10;
+    static const uint32_t MAXIMUM_SIZE = 16u << 20;
+
+    Dictionary() = default;
+
+    explicit Dictionary(std::vector<uint8_t> content) :
+            dictionaryId(hash(content)), dictionaryContent(std::move(content)),
+            lzwPrimer(dictionaryContent.data(), dictionaryContent.size()) {}
+
+    // Stored in the header of the compressed data, which can only be decompressed with the same dictionary
+    uint32_t id() const {
+        return dictionaryId;
+    }
+
+    const std::vector<uint8_t>& content() const {
+        return dictionaryContent;
+    }
+
+    const LZW::Primer& primer() const {
+        return lzwPrimer;
+    }
+
+    bool save(const std::string& filename) const {
+        uint8_t header[HEADER_SIZE];
+        memcpy(header, magic(), 4);
+        header[4] = VERSION;
+        BinaryIO::storeUint32(header + 5, dictionaryId);
+
+        remove(filename.c_str()); // Remove Output File If Exists
+        std::ofstream output(filename, std::ios::out | std::ios::binary);
+        output.write((const char*) header, sizeof(header));
+        output.write((const char*) dictionaryContent.data(), dictionaryContent.size());
+        return output.good();
+    }
+
+    /**
+     * Reads a dictionary saved by save(), its words are learnt again from the content <br>
+     * Returns false if it is not a dictionary or its content does not match its ID
+     */
+    static bool load(const std::string& filename, Dictionary& dictionary) {
+        std::ifstream input(filename, std::ios::in | std::ios::binary);
+        int64_t fileSize = BinaryIO::getFileSize(input);
+
+        uint8_t header[HEADER_SIZE];
+        if (fileSize < HEADER_SIZE || fileSize - HEADER_SIZE > MAXIMUM_SIZE ||
+            !BinaryIO::read(input, 0, header, sizeof(header)) || memcmp(header, magic(), 4) != 0 || header[4] != VERSION)
+            return false;
+
+        std::vector<uint8_t> content(fileSize - HEADER_SIZE);
+        if (!BinaryIO::read(input, HEADER_SIZE, content.data(), content.size()) ||
+            hash(content) != BinaryIO::loadUint32(header + 5))
+            return false;
+
+        dictionary = Dictionary(std::move(content));
+        return true;
+    }
+
+private:
+
+    static const uint8_t* magic() {
+        static const uint8_t MAGIC[4] = {'C', 'M', 'P', 'D'};
+        return MAGIC;
+    }
+
+    // FNV-1a of the content, so the same samples always give the same ID
+    static uint32_t hash(const std::vector<uint8_t>& content) {
+        uint32_t hash = 2166136261u;
+        for (uint8_t byte : content)
+            hash = (hash ^ byte) * 16777619u;
+        return hash != Format::NO_DICTIONARY ? hash : 1;
+    }
+
+};
+
+#endif //DICTIONARY_H
@@ -0,0 +1,516 @@
+#ifndef FM_INDEX_H
+#define FM_INDEX_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "MTF.h"
+#include "LZW/LZW.h"
+#include "LZW/Utils.h"
+#include "../Utils/BinaryIO.h"
+#include "../Utils/BitIO.h"
+
+/**
+ * FM-index of a block, finds a pattern in the BWT of the block without decompressing all of it <br>
+ * The rows of the BWT are coded in segments (the MTF and the LZW restart at each one), and the index stores
+ * the occurrences of every byte in each segment, so counting the occurrences of a byte before a row
+ * only decodes the segment of the row. A pattern is counted by a backward search, which reads 2 rows per byte of it.
+ * The segments of a single byte (runs, zeros) are not coded, their occurrences are enough <br>
+ * The rows of one text position out of the sample rate are stored to locate the matches and extract the text around
+ * them, the rate grows from SAMPLE_RATE for the blocks compressing so well that the samples would outweigh their rows
+ *
+ * @Searchable_Block_Data (the BWT original index is in the block header)
+ * ___________________________________________________
+ * |  LZW Coded Data of the MTF of each segment      |
+ * |_________________________________________________|
+ * |  Index, for each segment (Varints):             |
+ * |   - Size of its LZW data                        |
+ * |   - Number of bytes occurring in it             |
+ * |   - Under SPARSE_COUNTS_LIMIT of them, each     |
+ * |     byte (1 Byte) and its occurrences, else a   |
+ * |     bitmap of the bytes (32 Bytes) then their   |
+ * |     occurrences                                 |
+ * |  Log2 of the sample rate / SAMPLE_RATE (1 Byte) |
+ * |  Then the rows of the text positions 0, rate,   |
+ * |  2 * rate... with the bits of the number of     |
+ * |  rows each, padded to a byte                    |
+ * |_________________________________________________|
+ * |  Size of the Index (4 Bytes, LE)                |
+ * ---------------------------------------------------
+ *
+ * The BWT of a block of n bytes has n + 1 rows, the '\0' at the original index stands for the sentinel
+ */
+class FMIndex {
+
+public:
+
+    // Rows of each segment, smaller ones are decoded faster by a search but compress less
+    static const uint32_t SEGMENT_SIZE = 64u << 10;
+
+    // One text position out of the sample rate has its row stored, locating a match takes rate / 2 steps on average
+    static const uint32_t SAMPLE_RATE = 256;
+    static const uint32_t MAXIMUM_SAMPLE_RATE = SAMPLE_RATE << 8;
+
+    // Segments with fewer different bytes list them, the others store a bitmap of them
+    static const uint32_t SPARSE_COUNTS_LIMIT = 32;
+
+    static uint32_t numberOfSegments(uint32_t length) {
+        return length / SEGMENT_SIZE + 1; // the rows are length + 1
+    }
+
+    static uint32_t numberOfSamples(uint32_t length, uint32_t sampleRate = SAMPLE_RATE) {
+        return (uint32_t) (((uint64_t) length + sampleRate - 1) / sampleRate);
+    }
+
+    // Bound of the indexes of [numberOfBlocks] blocks of [length] bytes in all, with a byte of rounding for each segment
+    static size_t indexBound(size_t length, size_t numberOfBlocks) {
+        size_t segments = (length + numberOfBlocks) / SEGMENT_SIZE + numberOfBlocks;
+        size_t samples = length / SAMPLE_RATE + numberOfBlocks;
+
+        // A size takes 5 bytes at most and an occurrence 3, as there are SEGMENT_SIZE rows at most
+        return segments * (5 + 2 + 32 + 256 * 3 + 1) + samples * 4 + numberOfBlocks * (1 + 1 + 4);
+    }
+
+    /**
+     * Writes the row of the text positions 0, SAMPLE_RATE, 2 * SAMPLE_RATE... to [samples],
+     * from the suffix array of the block the BWT was generated from
+     */
+    static void sample(const uint32_t* suffixArray, uint32_t length, uint32_t* samples) {
+        for (uint32_t i = 0; i < length; ++i) {
+            if (suffixArray[i] % SAMPLE_RATE == 0)
+                samples[suffixArray[i] / SAMPLE_RATE] = i + 1; // the first row is the sentinel
+        }
+    }
+
+    /**
+     * Writes the segments and the index of [bwt], the length + 1 rows generated by BWT::encode, to [output],
+     * [samples] are the rows written by sample() <br>
+     * [bwt] is overwritten by the MTF of its segments. Returns the size written, or SIZE_MAX if it does not fit in [capacity]
+     */
+    static size_t encode(uint8_t* bwt, uint32_t length, const uint32_t* samples, uint8_t* output, size_t capacity,
+                         MTF::Encoder& mtfEncoder, LZW::Encoder& lzwEncoder, const LZW::Primer* primer = nullptr) {
+        std::vector<uint8_t> index;
+        uint8_t varint[BinaryIO::MAXIMUM_VARINT_SIZE];
+
+        size_t position = 0;
+        for (uint32_t segment = 0; segment < numberOfSegments(length); ++segment) {
+            uint8_t* rows = bwt + (size_t) segment * SEGMENT_SIZE;
+            uint32_t numberOfRows = segmentRows(segment, length);
+
+            uint32_t counts[256] = {0};
+            for (uint32_t i = 0; i < numberOfRows; ++i)
+                counts[rows[i]]++;
+
+            size_t segmentSize = 0;
+            if (counts[rows[0]] != numberOfRows) {
+                mtfEncoder.reset();
+                mtfEncoder.encode(rows, numberOfRows);
+
+                BitWriter writer(output + position, capacity - position);
+                lzwEncoder.encode(rows, numberOfRows, writer, primer);
+                segmentSize = writer.flush();
+                if (writer.overflowed())
+                    return SIZE_MAX;
+                position += segmentSize;
+            }
+
+            index.insert(index.end(), varint, varint + BinaryIO::storeVarint(varint, segmentSize));
+            storeCounts(counts, index);
+        }
+
+        // The samples take an eighth of the segments at most, runs and zeros would otherwise grow many times
+        uint32_t sampleBits = numberOfBitsToStoreRangeOf(length + 1);
+        uint32_t rateBits = 0;
+        while ((SAMPLE_RATE << rateBits) < MAXIMUM_SAMPLE_RATE &&
+               (uint64_t) numberOfSamples(length, SAMPLE_RATE << rateBits) * sampleBits > position)
+            rateBits++;
+        index.push_back((uint8_t) rateBits);
+
+        uint32_t storedSamples = numberOfSamples(length, SAMPLE_RATE << rateBits);
+        size_t samplesOffset = index.size();
+        index.resize(samplesOffset + ((uint64_t) storedSamples * sampleBits + 7) / 8);
+        BitWriter writer(index.data() + samplesOffset, index.size() - samplesOffset);
+        for (uint32_t i = 0; i < storedSamples; ++i)
+            writer.write(samples[(size_t) i << rateBits], sampleBits);
+        writer.flush();
+
+        if (capacity - position < index.size() + 4)
+            return SIZE_MAX;
+        memcpy(output + position, index.data(), index.size());
+        BinaryIO::storeUint32(output + position + index.size(), index.size());
+        return position + index.size() + 4;
+    }
+
+    /**
+     * The decoders and the primer are used to decode the segments, they must outlive the index
+     */
+    FMIndex(MTF::Decoder& mtfDecoder, LZW::Decoder& lzwDecoder, const LZW::Primer* primer = nullptr)
+            : mtfDecoder(mtfDecoder), lzwDecoder(lzwDecoder), primer(primer) {}
+
+    /**
+     * Reads the index of the searchable data of a block of [length] bytes, [data] must outlive the index <br>
+     * Returns false if it is not consistent
+     */
+    bool open(const uint8_t* data, size_t dataLength, uint32_t length, uint32_t originalIndex) {
+        input = data;
+        blockLength = length;
+        sentinelRow = originalIndex;
+        segments.clear();
+        sampledRows.clear();
+
+        uint32_t rows = length + 1;
+        if (originalIndex >= rows || dataLength < 4 || BinaryIO::loadUint32(data + dataLength - 4) > dataLength - 4)
+            return false;
+
+        const uint8_t* end = data + dataLength - 4;
+        const uint8_t* source = end - BinaryIO::loadUint32(end);
+        size_t segmentsSize = source - data;
+
+        // The occurrences before each segment are the sums of the occurrences in the segments before it
+        uint32_t numberOfSegments = FMIndex::numberOfSegments(length);
+        segmentOffsets.assign(numberOfSegments + 1, 0);
+        occurrences.assign(((size_t) numberOfSegments + 1) * 256, 0);
+        for (uint32_t segment = 0; segment < numberOfSegments; ++segment) {
+            uint64_t segmentSize;
+            uint32_t counts[256] = {0};
+            if (!BinaryIO::loadVarint(source, end, segmentSize) || segmentSize > segmentsSize ||
+                !loadCounts(source, end, counts))
+                return false;
+            segmentOffsets[segment + 1] = segmentOffsets[segment] + segmentSize;
+
+            uint64_t segmentRowCount = 0;
+            for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+                occurrences[(size_t) (segment + 1) * 256 + symbol] = storedCount(segment, symbol) + counts[symbol];
+                segmentRowCount += counts[symbol];
+            }
+            if (segmentRowCount != segmentRows(segment, length))
+                return false;
+        }
+        if (segmentOffsets[numberOfSegments] != segmentsSize || storedCount(numberOfSegments, 0) == 0)
+            return false;
+
+        // The first row is the sentinel alone, then the rows of the text starting with each byte
+        for (uint32_t symbol = 0, row = 1; symbol < 256; ++symbol) {
+            firstRow[symbol] = row;
+            row += storedCount(numberOfSegments, symbol) - (symbol == 0 ? 1 : 0);
+        }
+
+        if (source == end || *source > 16 || (SAMPLE_RATE << *source) > MAXIMUM_SAMPLE_RATE)
+            return false;
+        sampleRate = SAMPLE_RATE << *source++;
+
+        uint32_t sampleBits = numberOfBitsToStoreRangeOf(rows);
+        if ((uint64_t) (end - source) != ((uint64_t) numberOfSamples(length, sampleRate) * sampleBits + 7) / 8)
+            return false;
+
+        BitReader reader(source, end - source);
+        samples.resize(numberOfSamples(length, sampleRate));
+        for (uint32_t& sample : samples) {
+            sample = reader.read(sampleBits);
+            if (sample >= rows)
+                return false;
+        }
+
+        segments.resize(numberOfSegments);
+        return true;
+    }
+
+    uint32_t length() const {
+        return blockLength;
+    }
+
+    // One text position out of it has its row stored, locating a match reads as many rows at most
+    uint32_t samplingRate() const {
+        return sampleRate;
+    }
+
+    /**
+     * Decodes all the rows of the BWT to [bwt], which must have room for length + 1 bytes <br>
+     * Returns false if a segment is corrupted
+     */
+    bool decode(uint8_t* bwt) {
+        for (uint32_t segment = 0; segment < segments.size(); ++segment) {
+            if (!decodeSegment(segment, bwt + (size_t) segment * SEGMENT_SIZE))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * Finds the rows [first, last) of the suffixes starting with [pattern], their number is its number of occurrences <br>
+     * Returns false if a segment is corrupted
+     */
+    bool findRows(const uint8_t* pattern, size_t patternLength, uint32_t& first, uint32_t& last) {
+        first = 0;
+        last = blockLength + 1;
+        for (size_t i = patternLength; i > 0 && first < last; --i) {
+            uint8_t symbol = pattern[i - 1];
+            uint32_t occurrencesBeforeFirst, occurrencesBeforeLast;
+            if (!countBefore(symbol, first, occurrencesBeforeFirst) || !countBefore(symbol, last, occurrencesBeforeLast))
+                return false;
+
+            first = firstRow[symbol] + occurrencesBeforeFirst;
+            last = firstRow[symbol] + occurrencesBeforeLast;
+        }
+        return true;
+    }
+
+    /**
+     * Position in the text of the suffix of [row], found by moving to the previous position until a sampled one <br>
+     * Returns false if a segment is corrupted
+     */
+    bool locate(uint32_t row, uint32_t& position) {
+        if (sampledRows.empty())
+            sortSamples();
+
+        for (uint32_t steps = 0; steps < sampleRate; ++steps) {
+            auto sample = std::lower_bound(sampledRows.begin(), sampledRows.end(), std::make_pair(row, (uint32_t) 0));
+            if (sample != sampledRows.end() && sample->first == row) {
+                position = sample->second + steps;
+                return true;
+            }
+
+            // The sentinel row is the text position 0, which is sampled
+            if (!previousRow(row))
+                return false;
+        }
+        return false;
+    }
+
+    /**
+     * Writes the text [begin, end) to [output], read backwards from the sampled position after it <br>
+     * Returns false if a segment is corrupted
+     */
+    bool extract(uint32_t begin, uint32_t end, uint8_t* output) {
+        if (begin >= end)
+            return true;
+
+        // The first row is the end of the text
+        uint64_t position = ((uint64_t) end + sampleRate - 1) / sampleRate * sampleRate;
+        uint32_t row = 0;
+        if (position < blockLength)
+            row = samples[position / sampleRate];
+        else
+            position = blockLength;
+
+        while (position > begin) {
+            uint8_t symbol;
+            if (!rowSymbol(row, symbol))
+                return false;
+
+            position--;
+            if (position < end)
+                output[position - begin] = symbol;
+            if (position > begin && !previousRow(row))
+                return false;
+        }
+        return true;
+    }
+
+private:
+
+    // Occurrences before each checkpoint of a decoded segment, so counting them scans CHECKPOINT_INTERVAL rows at most
+    static const uint32_t CHECKPOINT_INTERVAL = 1024;
+
+    struct Segment {
+        std::vector<uint8_t> rows;
+        std::vector<uint16_t> checkpoints; // 256 occurrences for each checkpoint, from the start of the segment
+    };
+
+    MTF::Decoder& mtfDecoder;
+    LZW::Decoder& lzwDecoder;
+    const LZW::Primer* primer;
+
+    const uint8_t* input = nullptr;
+    uint32_t blockLength = 0;
+    uint32_t sentinelRow = 0;
+    uint32_t sampleRate = SAMPLE_RATE;
+    uint32_t firstRow[256];
+    std::vector<uint64_t> segmentOffsets;
+    std::vector<uint32_t> occurrences; // of the 256 bytes before each segment, then in all the rows
+    std::vector<uint32_t> samples;
+    std::vector<Segment> segments; // decoded when a search reads them
+    std::vector<std::pair<uint32_t, uint32_t>> sampledRows; // (row, text position), sorted by row when locating
+
+    static void storeCounts(const uint32_t* counts, std::vector<uint8_t>& index) {
+        uint8_t varint[BinaryIO::MAXIMUM_VARINT_SIZE];
+        uint32_t usedSymbols = 0;
+        uint8_t bitmap[32] = {0};
+        for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+            if (counts[symbol] > 0) {
+                usedSymbols++;
+                bitmap[symbol / 8] |= (uint8_t) (1u << (symbol % 8));
+            }
+        }
+
+        index.insert(index.end(), varint, varint + BinaryIO::storeVarint(varint, usedSymbols));
+        if (usedSymbols >= SPARSE_COUNTS_LIMIT)
+            index.insert(index.end(), bitmap, bitmap + sizeof(bitmap));
+        for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+            if (counts[symbol] == 0)
+                continue;
+            if (usedSymbols < SPARSE_COUNTS_LIMIT)
+                index.push_back((uint8_t) symbol);
+            index.insert(index.end(), varint, varint + BinaryIO::storeVarint(varint, counts[symbol]));
+        }
+    }
+
+    // Returns false if the counts are not consistent, [counts] must be zeros
+    static bool loadCounts(const uint8_t*& source, const uint8_t* end, uint32_t* counts) {
+        uint64_t usedSymbols;
+        if (!BinaryIO::loadVarint(source, end, usedSymbols) || usedSymbols > 256)
+            return false;
+
+        bool isSparse = usedSymbols < SPARSE_COUNTS_LIMIT;
+        const uint8_t* bitmap = source;
+        if (!isSparse) {
+            if (end - source < 32)
+                return false;
+            source += 32;
+        }
+
+        for (uint32_t symbol = 0, loaded = 0; loaded < usedSymbols; ++loaded, ++symbol) {
+            if (isSparse) {
+                // The bytes are listed in increasing order
+                if (source == end || *source < symbol)
+                    return false;
+                symbol = *source++;
+            } else {
+                while (symbol < 256 && (bitmap[symbol / 8] >> (symbol % 8) & 1) == 0)
+                    symbol++;
+                if (symbol == 256)
+                    return false;
+            }
+
+            uint64_t count;
+            if (!BinaryIO::loadVarint(source, end, count) || count == 0 || count > SEGMENT_SIZE)
+                return false;
+            counts[symbol] = (uint32_t) count;
+        }
+        return true;
+    }
+
+    static uint32_t segmentRows(uint32_t segment, uint32_t length) {
+        uint32_t begin = segment * SEGMENT_SIZE;
+        return length + 1 - begin < SEGMENT_SIZE ? length + 1 - begin : SEGMENT_SIZE;
+    }
+
+    uint32_t storedCount(uint32_t segment, uint8_t symbol) const {
+        return occurrences[(size_t) segment * 256 + symbol];
+    }
+
+    // LZW then MTF of the segment to [output], which has room for its rows, or the byte of a segment not coded
+    bool decodeSegment(uint32_t segment, uint8_t* output) {
+        uint32_t rows = segmentRows(segment, blockLength);
+        if (segmentOffsets[segment + 1] == segmentOffsets[segment]) {
+            for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+                if (storedCount(segment + 1, symbol) - storedCount(segment, symbol) == rows) {
+                    memset(output, symbol, rows);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        BitReader reader(input + segmentOffsets[segment], segmentOffsets[segment + 1] - segmentOffsets[segment]);
+        LZW::BufferSink sink(output, rows);
+        if (!lzwDecoder.decode(reader, sink, primer) || sink.size != rows)
+            return false;
+
+        mtfDecoder.reset();
+        mtfDecoder.decode(output, rows);
+        return true;
+    }
+
+    // Decodes the segment if a search did not yet, and checks it against the stored occurrences
+    bool loadSegment(uint32_t segment) {
+        Segment& loaded = segments[segment];
+        if (!loaded.rows.empty())
+            return true;
+
+        uint32_t rows = segmentRows(segment, blockLength);
+        std::vector<uint8_t> decoded(rows);
+        if (!decodeSegment(segment, decoded.data()))
+            return false;
+
+        uint32_t checkpoints = (rows + CHECKPOINT_INTERVAL - 1) / CHECKPOINT_INTERVAL;
+        std::vector<uint16_t> counts((size_t) checkpoints * 256);
+        uint32_t segmentCounts[256] = {0};
+        for (uint32_t i = 0; i < rows; ++i) {
+            if (i % CHECKPOINT_INTERVAL == 0)
+                std::copy(segmentCounts, segmentCounts + 256, counts.begin() + (size_t) (i / CHECKPOINT_INTERVAL) * 256);
+            segmentCounts[decoded[i]]++;
+        }
+
+        for (uint32_t symbol = 0; symbol < 256; ++symbol) {
+            if (segmentCounts[symbol] != storedCount(segment + 1, symbol) - storedCount(segment, symbol))
+                return false;
+        }
+        uint32_t begin = segment * SEGMENT_SIZE;
+        if (sentinelRow >= begin && sentinelRow - begin < rows && decoded[sentinelRow - begin] != 0)
+            return false;
+
+        loaded.rows = std::move(decoded);
+        loaded.checkpoints = std::move(counts);
+        return true;
+    }
+
+    bool rowSymbol(uint32_t row, uint8_t& symbol) {
+        uint32_t segment = row / SEGMENT_SIZE;
+        if (!loadSegment(segment))
+            return false;
+
+        symbol = segments[segment].rows[row % SEGMENT_SIZE];
+        return true;
+    }
+
+    // Occurrences of [symbol] in the rows before [row] (the sentinel is not a '\0' of the text)
+    bool countBefore(uint8_t symbol, uint32_t row, uint32_t& count) {
+        uint32_t segment = row / SEGMENT_SIZE;
+        uint32_t offset = row % SEGMENT_SIZE;
+        count = storedCount(segment, symbol);
+
+        // The occurrences before a segment are in the index, the others need the segment
+        if (offset > 0) {
+            if (!loadSegment(segment))
+                return false;
+
+            const Segment& loaded = segments[segment];
+            uint32_t checkpoint = offset / CHECKPOINT_INTERVAL;
+            count += loaded.checkpoints[(size_t) checkpoint * 256 + symbol];
+            for (uint32_t i = checkpoint * CHECKPOINT_INTERVAL; i < offset; ++i)
+                count += loaded.rows[i] == symbol;
+        }
+
+        // A segment not decoded yet may be corrupted, the count of the sentinel is then missing
+        if (symbol == 0 && sentinelRow < row) {
+            if (count == 0)
+                return false;
+            count--;
+        }
+        return true;
+    }
+
+    // Moves [row] to the row of the previous text position, [row] must not be the sentinel row
+    bool previousRow(uint32_t& row) {
+        uint8_t symbol;
+        uint32_t count;
+        if (row == sentinelRow || !rowSymbol(row, symbol) || !countBefore(symbol, row, count))
+            return false;
+
+        row = firstRow[symbol] + count;
+        return true;
+    }
+
+    void sortSamples() {
+        sampledRows.resize(samples.size());
+        for (uint32_t i = 0; i < samples.size(); ++i)
+            sampledRows[i] = {samples[i], i * sampleRate};
+        std::sort(sampledRows.begin(), sampledRows.end());
+    }
+
+};
+
+#endif //FM_INDEX_H
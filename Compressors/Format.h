@@ -0,0 +1,228 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../Utils/BinaryIO.h"
+
+/**
+ * Layout of compressed files, the input is split into blocks compressed independently,
+ * an index at the end maps the original offset of each block to its compressed offset
+ * so any range can be decompressed without decoding the blocks before it
+ *
+ * @File_Format
+ * ___________________________________________________
+ * |             Magic Number "CMPR" (4 Bytes)       |
+ * |                 Version (1 Byte)                |
+ * |                  Flags (1 Byte)                 |
+ * |            Block Size (4 Bytes, LE)             |
+ * |           Original Size (8 Bytes, LE)           |
+ * |          Dictionary ID (4 Bytes, LE)            |
+ * |_________________________________________________|
+ * |  Blocks, each one consists of:                  |
+ * |   - Block Flags (1 Byte)                        |
+ * |   - BWT Original Index (4 Bytes, LE)            |
+ * |   - CRC32C of the original block (4 Bytes, LE)  |
+ * |   - Numeric Filter (2 Bytes) if the flag is set |
+ * |   - Data of the pipeline of the block flags     |
+ * |     (LZW Coded Data of MTF of BWT by default,   |
+ * |     of its word transform or numeric filter     |
+ * |     then of its RLE if the block flags are set) |
+ * |_________________________________________________|
+ * |  Index, for each block:                         |
+ * |   - Original Offset (8 Bytes, LE)               |
+ * |   - Compressed Offset (8 Bytes, LE)             |
+ * |_________________________________________________|
+ * |  Footer:                                        |
+ * |   - Data Size (8 Bytes, LE)                     |
+ * |   - Index Offset (8 Bytes, LE)                  |
+ * |   - Number of Blocks (4 Bytes, LE)              |
+ * |   - Magic Number "CMPR" (4 Bytes)               |
+ * ---------------------------------------------------
+ *
+ * The flags tell which filters were applied to the whole input before splitting it in blocks,
+ * the blocks and the index then describe the filtered data, of Data Size bytes <br>
+ * The adaptive mode of Compressor.h chooses the pipeline of each block, the BWT index is 0 for the others <br>
+ * The searchable pipeline replaces the BWT one when the blocks are indexed for searches <br>
+ * The LZW of every block is primed with the trained dictionary of that ID (Dictionary.h), 0 if there is none <br>
+ * Files without the magic number are decoded with the original format, which has no header
+ */
+namespace Format {
+
+    const uint8_t MAGIC[4] = {'C', 'M', 'P', 'R'};
+    const uint8_t VERSION = 7;
+
+    // Long range matching of LongRange.h
+    const uint8_t FLAG_LONG_RANGE = 1 << 0;
+    const uint8_t KNOWN_FLAGS = FLAG_LONG_RANGE;
+
+    // Run length encoding of RLE.h, applied to each block before the BWT when it makes it smaller
+    const uint8_t BLOCK_FLAG_RUN_LENGTH = 1 << 0;
+
+    // Pipeline of each block, in bits 1 and 2 of its flags
+    const uint8_t BLOCK_PIPELINE_SHIFT = 1;
+    const uint8_t BLOCK_PIPELINE_MASK = 3 << BLOCK_PIPELINE_SHIFT;
+    const uint8_t PIPELINE_BWT = 0;     // LZW of the MTF of the BWT
+    const uint8_t PIPELINE_HUFFMAN = 1; // Huffman coding alone, for data without context but with skewed bytes
+    const uint8_t PIPELINE_STORED = 2;  // Copied as is, for data which does not compress
+    const uint8_t PIPELINE_SEARCHABLE = 3; // LZW of the MTF of the BWT in segments, with an FM-index (FMIndex.h)
+    const uint8_t NUMBER_OF_PIPELINES = 4;
+
+    // Word replacing transform of WordTransform.h, applied to each block before the RLE when it makes it smaller
+    const uint8_t BLOCK_FLAG_WORDS = 1 << 3;
+
+    // Numeric filter of NumericTransform.h, applied to each block before the RLE instead of the word transform
+    const uint8_t BLOCK_FLAG_NUMERIC = 1 << 4;
+
+    const uint8_t KNOWN_BLOCK_FLAGS = BLOCK_FLAG_RUN_LENGTH | BLOCK_PIPELINE_MASK | BLOCK_FLAG_WORDS |
+                                      BLOCK_FLAG_NUMERIC;
+
+    const uint32_t NO_DICTIONARY = 0;
+
+    const size_t HEADER_SIZE = sizeof(MAGIC) + 1 + 1 + 4 + 8 + 4;
+    const size_t BLOCK_HEADER_SIZE = 1 + 4 + 4;
+    const size_t INDEX_ENTRY_SIZE = 8 + 8;
+    const size_t FOOTER_SIZE = 8 + 8 + 4 + sizeof(MAGIC);
+
+    // Bigger blocks give better compression ratio, smaller ones need less memory and give faster random access
+    const uint32_t DEFAULT_BLOCK_SIZE = 32u << 20;
+    const uint32_t MINIMUM_BLOCK_SIZE = 1u << 10;
+    // The suffix array is built with 32 bits signed integers
+    const uint32_t MAXIMUM_BLOCK_SIZE = INT32_MAX - 16;
+
+    struct Header {
+        uint8_t flags;
+        uint32_t blockSize;
+        uint64_t originalSize;
+        uint32_t dictionaryId;
+    };
+
+    struct Footer {
+        uint64_t dataSize; // the original size if no filter is applied
+        uint64_t indexOffset;
+        uint32_t numberOfBlocks;
+    };
+
+    struct BlockEntry {
+        uint64_t originalOffset;
+        uint64_t compressedOffset;
+        uint32_t originalSize;
+        uint32_t compressedSize;
+    };
+
+    inline void writeHeader(uint8_t* output, const Header& header) {
+        memcpy(output, MAGIC, sizeof(MAGIC));
+        output[sizeof(MAGIC)] = VERSION;
+        output[sizeof(MAGIC) + 1] = header.flags;
+        BinaryIO::storeUint32(output + sizeof(MAGIC) + 2, header.blockSize);
+        BinaryIO::storeUint64(output + sizeof(MAGIC) + 6, header.originalSize);
+        BinaryIO::storeUint32(output + sizeof(MAGIC) + 14, header.dictionaryId);
+    }
+
+    // Returns false if [input] is not a header of this version or it uses unknown filters
+    inline bool readHeader(const uint8_t* input, size_t length, Header& header) {
+        if (length < HEADER_SIZE || memcmp(input, MAGIC, sizeof(MAGIC)) != 0 || input[sizeof(MAGIC)] != VERSION)
+            return false;
+
+        header.flags = input[sizeof(MAGIC) + 1];
+        header.blockSize = BinaryIO::loadUint32(input + sizeof(MAGIC) + 2);
+        header.originalSize = BinaryIO::loadUint64(input + sizeof(MAGIC) + 6);
+        header.dictionaryId = BinaryIO::loadUint32(input + sizeof(MAGIC) + 14);
+        return (header.flags & ~KNOWN_FLAGS) == 0 &&
+               header.blockSize >= MINIMUM_BLOCK_SIZE && header.blockSize <= MAXIMUM_BLOCK_SIZE;
+    }
+
+    inline bool hasMagic(const uint8_t* input, size_t length) {
+        return length >= sizeof(MAGIC) && memcmp(input, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    inline void writeFooter(uint8_t* output, const Footer& footer) {
+        BinaryIO::storeUint64(output, footer.dataSize);
+        BinaryIO::storeUint64(output + 8, footer.indexOffset);
+        BinaryIO::storeUint32(output + 16, footer.numberOfBlocks);
+        memcpy(output + 20, MAGIC, sizeof(MAGIC));
+    }
+
+    // [input] is the last FOOTER_SIZE bytes of the file
+    inline bool readFooter(const uint8_t* input, Footer& footer) {
+        if (memcmp(input + 20, MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+
+        footer.dataSize = BinaryIO::loadUint64(input);
+        footer.indexOffset = BinaryIO::loadUint64(input + 8);
+        footer.numberOfBlocks = BinaryIO::loadUint32(input + 16);
+        return true;
+    }
+
+    inline size_t indexSize(uint32_t numberOfBlocks) {
+        return (size_t) numberOfBlocks * INDEX_ENTRY_SIZE;
+    }
+
+    inline void writeIndex(uint8_t* output, const std::vector<BlockEntry>& blocks) {
+        for (const BlockEntry& block : blocks) {
+            BinaryIO::storeUint64(output, block.originalOffset);
+            BinaryIO::storeUint64(output + 8, block.compressedOffset);
+            output += INDEX_ENTRY_SIZE;
+        }
+    }
+
+    /**
+     * Reads the index, the sizes of each block are the distance to the next one <br>
+     * Returns false if the offsets are not consistent with the footer and the block size,
+     * the first block must start at [firstBlockOffset]
+     */
+    inline bool readIndex(const uint8_t* input, const Footer& footer, uint32_t blockSize, std::vector<BlockEntry>& blocks,
+                          uint64_t firstBlockOffset = HEADER_SIZE) {
+        blocks.resize(footer.numberOfBlocks);
+        for (uint32_t i = 0; i < footer.numberOfBlocks; ++i) {
+            blocks[i].originalOffset = BinaryIO::loadUint64(input + i * INDEX_ENTRY_SIZE);
+            blocks[i].compressedOffset = BinaryIO::loadUint64(input + i * INDEX_ENTRY_SIZE + 8);
+        }
+
+        uint64_t expectedOriginalOffset = 0;
+        uint64_t expectedCompressedOffset = firstBlockOffset;
+        for (uint32_t i = 0; i < footer.numberOfBlocks; ++i) {
+            uint64_t nextOriginalOffset = i + 1 < footer.numberOfBlocks ? blocks[i + 1].originalOffset : footer.dataSize;
+            uint64_t nextCompressedOffset = i + 1 < footer.numberOfBlocks ? blocks[i + 1].compressedOffset : footer.indexOffset;
+
+            if (blocks[i].originalOffset != expectedOriginalOffset || blocks[i].compressedOffset != expectedCompressedOffset)
+                return false;
+            if (nextOriginalOffset <= blocks[i].originalOffset || nextOriginalOffset - blocks[i].originalOffset > blockSize)
+                return false;
+            if (nextCompressedOffset < blocks[i].compressedOffset + BLOCK_HEADER_SIZE ||
+                nextCompressedOffset - blocks[i].compressedOffset > UINT32_MAX)
+                return false;
+
+            blocks[i].originalSize = nextOriginalOffset - blocks[i].originalOffset;
+            blocks[i].compressedSize = nextCompressedOffset - blocks[i].compressedOffset;
+            expectedOriginalOffset = nextOriginalOffset;
+            expectedCompressedOffset = nextCompressedOffset;
+        }
+
+        return expectedOriginalOffset == footer.dataSize && expectedCompressedOffset == footer.indexOffset;
+    }
+
+    /**
+     * Returns the range [first, last) of the blocks overlapping the original bytes [offset, offset + length)
+     */
+    inline std::pair<size_t, size_t> findBlocks(const std::vector<BlockEntry>& blocks, uint64_t offset, uint64_t length) {
+        auto byOriginalOffset = [](uint64_t value, const BlockEntry& block) {
+            return value < block.originalOffset;
+        };
+
+        // The first block starting after the offset, the one before it contains the offset
+        size_t first = std::upper_bound(blocks.begin(), blocks.end(), offset, byOriginalOffset) - blocks.begin();
+        first = first > 0 ? first - 1 : 0;
+
+        size_t last = std::upper_bound(blocks.begin(), blocks.end(), offset + length - 1, byOriginalOffset) - blocks.begin();
+        if (length == 0 || first >= blocks.size() || offset >= blocks.back().originalOffset + blocks.back().originalSize)
+            return {0, 0};
+
+        return {first, last};
+    }
+
+}
+
+#endif //FORMAT_H
@@ -5,9 +5,11 @@
 #include <unordered_map>
 #include <functional>
 #include <cstdint>
+#include <cstring>
 
 #include "Node.h"
 #include "../../Utils/BinaryIO.h"
+#include "../../Utils/Stats.h"
 #include <bit_string.h>
 
 
@@ -39,27 +41,92 @@ class Huffman {
 
 public:
 
-    static void encode(const std::string& filename, const std::string& outputFileName) {
+    /**
+     * Encoding context, keeps the buffers of the file header and the coded data between calls <br>
+     * Independent encoders can run concurrently, a single one must not be shared between threads
+     */
+    class Encoder {
+        bit_string fileHeader;
+        bit_string encodedData;
 
-        std::string toBeEncoded = BinaryIO::readString(filename);
+    public:
+        // Receives the time and the sizes of each call if it is set
+        Stats::Recorder* stats = nullptr;
 
-        auto frequencies = generateFrequencies(toBeEncoded);
-        Node* huffmanTree = buildHuffmanTree(frequencies);
-        auto huffmanCodes = generateHuffmanCodes(huffmanTree);
+        // Returns the encoded size, or SIZE_MAX if it does not fit in [capacity]
+        size_t encode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+            Stats::Measure measure(stats, Stats::Stage::Huffman, length);
+            Huffman::encode(input, length, fileHeader, encodedData);
 
-        deallocateHuffmanTree(huffmanTree); // release memory
-        frequencies.clear(); // release memory
+            size_t fileHeaderSize = fileHeader.length_in_bytes();
+            size_t encodedDataSize = encodedData.length_in_bytes();
+            if (fileHeaderSize + encodedDataSize > capacity)
+                return SIZE_MAX;
 
-        bit_string binaryFileHeader = generateFileHeader(huffmanCodes);
+            memcpy(output, fileHeader.data(), fileHeaderSize);
+            memcpy(output + fileHeaderSize, encodedData.data(), encodedDataSize);
+            measure.setBytesOut(fileHeaderSize + encodedDataSize);
+            return fileHeaderSize + encodedDataSize;
+        }
+    };
 
-        remove(outputFileName.c_str()); // Remove Output File If Exists
-        BinaryIO::write(outputFileName, binaryFileHeader);
+    /**
+     * Decoding context, keeps the buffers of the coded and decoded data between calls <br>
+     * Independent decoders can run concurrently, a single one must not be shared between threads
+     */
+    class Decoder {
+        bit_string dictionary;
+        bit_string toBeDecoded;
+        bit_string decodedData;
+
+    public:
+        // Receives the time and the sizes of each call if it is set
+        Stats::Recorder* stats = nullptr;
+
+        // Returns the decoded size, or SIZE_MAX if it does not fit in [capacity] or the input is corrupted
+        size_t decode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+            Stats::Measure measure(stats, Stats::Stage::Huffman, length);
+            if (length < 2)
+                return SIZE_MAX;
+
+            // File Header Size In Bits is The First 2 Bytes of Data
+            copyBytes(input, 2, dictionary);
+            uint32_t fileHeaderSizeInBits = dictionary.to_uint_32();
+            if (fileHeaderSizeInBits < 2 * BYTE || byteSize(fileHeaderSizeInBits) >= length)
+                return SIZE_MAX;
+
+            copyBytes(input + 2, byteSize(fileHeaderSizeInBits) - 2, dictionary);
+            copyBytes(input + byteSize(fileHeaderSizeInBits), length - byteSize(fileHeaderSizeInBits), toBeDecoded);
+
+            Huffman::decode(dictionary, fileHeaderSizeInBits, toBeDecoded, decodedData);
+
+            size_t decodedDataSize = decodedData.length_in_bytes();
+            if (decodedDataSize > capacity)
+                return SIZE_MAX;
+
+            memcpy(output, decodedData.data(), decodedDataSize);
+            measure.setBytesOut(decodedDataSize);
+            return decodedDataSize;
+        }
+
+    private:
+        static void copyBytes(const uint8_t* input, size_t length, bit_string& output) {
+            output.resize(length * BYTE);
+            memcpy(output.data(), input, length);
+        }
+    };
 
-        binaryFileHeader.clear();
-        binaryFileHeader.shrink_to_fit(); // release memory
 
-        bit_string encodedData = encode(toBeEncoded, huffmanCodes);
+    static void encode(const std::string& filename, const std::string& outputFileName) {
+
+        std::string toBeEncoded = BinaryIO::readString(filename);
 
+        bit_string binaryFileHeader;
+        bit_string encodedData;
+        encode((const uint8_t*) toBeEncoded.data(), toBeEncoded.size(), binaryFileHeader, encodedData);
+
+        remove(outputFileName.c_str()); // Remove Output File If Exists
+        BinaryIO::write(outputFileName, binaryFileHeader);
         BinaryIO::write(outputFileName, encodedData);
     }
 
@@ -70,26 +137,15 @@ public:
         uint32_t fileHeaderSizeInBits = BinaryIO::readBitString(filename, 0, 2).to_uint_32();
 
         // The remaining of the file header is the huffman dictionary
-        bit_string dictionary = BinaryIO::readBitString(filename, 2, byteSize(fileHeaderSizeInBits));
-
-        uint32_t dictionarySizeInBits = fileHeaderSizeInBits - 2 * BYTE;
-
-        // Remove Extra bits in last byte
-        dictionary.pop_back(dictionary.size() - dictionarySizeInBits);
-
-        auto huffmanCodes = reconstructHuffmanCodes(dictionary);
-        dictionary.clear();
-        dictionary.shrink_to_fit(); // release memory
-        Node* huffmanTree = reconstructHuffmanTree(huffmanCodes);
+        bit_string dictionary = BinaryIO::readBitString(filename, 2, byteSize(fileHeaderSizeInBits) - 2);
 
         bit_string toBeDecoded = BinaryIO::readBitString(filename, byteSize(fileHeaderSizeInBits));
 
-        bit_string decodedData = decode(toBeDecoded, huffmanCodes, huffmanTree);
+        bit_string decodedData;
+        decode(dictionary, fileHeaderSizeInBits, toBeDecoded, decodedData);
 
         remove(outputFileName.c_str()); // Remove Output File If Exists
         BinaryIO::write(outputFileName, decodedData);
-
-        deallocateHuffmanTree(huffmanTree); // release memory
     }
 
 
@@ -100,11 +156,47 @@ private:
     }
 
 
-    static bit_string encode(const std::string& toBeEncoded, std::unordered_map<uint8_t, bit_string>& huffmanCodes) {
-        bit_string encodedData;
-        encodedData.reserve(toBeEncoded.size() / (4 * BYTE));
-        for (char c : toBeEncoded) {
-            encodedData += huffmanCodes[c];
+    static void encode(const uint8_t* toBeEncoded, size_t length, bit_string& fileHeader, bit_string& encodedData) {
+
+        auto frequencies = generateFrequencies(toBeEncoded, length);
+
+        std::unordered_map<uint8_t, bit_string> huffmanCodes;
+        if (!frequencies.empty()) {
+            Node* huffmanTree = buildHuffmanTree(frequencies);
+            huffmanCodes = generateHuffmanCodes(huffmanTree);
+            deallocateHuffmanTree(huffmanTree); // release memory
+        }
+
+        frequencies.clear(); // release memory
+
+        fileHeader = generateFileHeader(huffmanCodes);
+        encode(toBeEncoded, length, huffmanCodes, encodedData);
+    }
+
+
+    // [dictionary] is the file header after its size (2 Bytes), [toBeDecoded] is the rest of the data
+    static void decode(bit_string& dictionary, uint32_t fileHeaderSizeInBits, bit_string& toBeDecoded, bit_string& decodedData) {
+
+        uint32_t dictionarySizeInBits = fileHeaderSizeInBits - 2 * BYTE;
+
+        // Remove Extra bits in last byte
+        dictionary.pop_back(dictionary.size() - dictionarySizeInBits);
+
+        auto huffmanCodes = reconstructHuffmanCodes(dictionary);
+        Node* huffmanTree = reconstructHuffmanTree(huffmanCodes);
+
+        decode(toBeDecoded, huffmanCodes, huffmanTree, decodedData);
+
+        deallocateHuffmanTree(huffmanTree); // release memory
+    }
+
+
+    static void encode(const uint8_t* toBeEncoded, size_t length, std::unordered_map<uint8_t, bit_string>& huffmanCodes,
+                       bit_string& encodedData) {
+        encodedData.clear();
+        encodedData.reserve(length / (4 * BYTE));
+        for (size_t i = 0; i < length; ++i) {
+            encodedData += huffmanCodes[toBeEncoded[i]];
         }
 
         uint8_t extraBitsInLastByte = encodedData.extra_bits_size();
@@ -113,17 +205,22 @@ private:
         }
 
         encodedData += extraBitsInLastByte;
-        return encodedData;
     }
 
 
-    static bit_string decode(bit_string& toBeDecoded, std::unordered_map<bit_string, uint8_t>& huffmanCodes, Node* huffmanTree) {
+    static void decode(bit_string& toBeDecoded, std::unordered_map<bit_string, uint8_t>& huffmanCodes, Node* huffmanTree,
+                       bit_string& decodedData) {
+
+        decodedData.clear();
+        if (toBeDecoded.size() < BYTE)
+            return;
 
         uint8_t extraBitsInLastByte = toBeDecoded.back_byte();
         toBeDecoded.pop_back(BYTE);
+        if (extraBitsInLastByte >= BYTE || extraBitsInLastByte > toBeDecoded.size())
+            return;
         toBeDecoded.pop_back(extraBitsInLastByte);
 
-        bit_string decodedData;
         decodedData.reserve(toBeDecoded.size());
 
         bit_string currentCode;
@@ -135,6 +232,10 @@ private:
             else if (toBeDecodedBit == 0)
                 currentNode = currentNode->right;
 
+            // Corrupted data, the code does not exist
+            if (currentNode == nullptr)
+                return;
+
             currentCode += toBeDecodedBit;
 
             if (currentNode->isLeaf()) {
@@ -143,7 +244,6 @@ private:
                 currentNode = huffmanTree;
             }
         }
-        return decodedData;
     }
 
 
@@ -167,6 +267,13 @@ private:
             code.pop_back();
         };
 
+        // A tree of a single symbol has an empty code, give it one bit so it can still be decoded
+        if (huffmanTree->isLeaf()) {
+            code.push_back(0);
+            huffmanCodes.emplace(huffmanTree->value, code);
+            return huffmanCodes;
+        }
+
         generateHuffmanCodesRecursive(huffmanTree);
 
         return huffmanCodes;
@@ -273,10 +380,10 @@ private:
     }
 
 
-    static std::unordered_map<uint8_t, uint32_t> generateFrequencies(const std::string& input) {
+    static std::unordered_map<uint8_t, uint32_t> generateFrequencies(const uint8_t* input, size_t length) {
         std::unordered_map<uint8_t, uint32_t> frequencies(256);
-        for (uint8_t currentChar : input) {
-            frequencies[currentChar]++;
+        for (size_t i = 0; i < length; ++i) {
+            frequencies[input[i]]++;
         }
         return frequencies;
     }
@@ -1,10 +1,13 @@
 #ifndef LZW_H
 #define LZW_H
 
+#include <algorithm>
 #include <string>
-#include <unordered_map>
 #include <cstdint>
+#include <vector>
 #include "../../Utils/BinaryIO.h"
+#include "../../Utils/ScratchArena.h"
+#include "../../Utils/BitIO.h"
 #include "Utils.h"
 #include <bit_string.h>
 
@@ -15,97 +18,466 @@ class LZW {
 
     static const uint32_t BYTE = 8;
 
-    static std::unordered_map<std::string, uint32_t> initializeEncodingDictionary() {
-        std::unordered_map<std::string, uint32_t> encodingDictionary(256);
-        for (int i = 0; i < 256; ++i) {
-            std::string s(1, i);
-            encodingDictionary[s] = i;
+    static const uint32_t ALPHABET_SIZE = 256;
+    static const uint64_t EMPTY_SLOT = UINT64_MAX;
+
+    // Codes packed or unpacked at once by the kernels of BitIO.h
+    static const size_t RUN_SIZE = 256;
+
+    /**
+     * Maps (code of a word, next byte) to the code of the extended word <br>
+     * Open addressing hash table living in the scratch arena, so growing the dictionary does not
+     * allocate a string and a node for every word as std::unordered_map<std::string, uint32_t> did
+     */
+    struct EncodingDictionary {
+        ScratchArena& arena;
+        uint64_t* keys;
+        uint32_t* codes;
+        size_t capacity;
+        uint32_t size; // Number of words including the single bytes
+
+        EncodingDictionary(ScratchArena& arena, size_t expectedWords) : arena(arena) {
+            size = ALPHABET_SIZE; // single bytes are their own codes and are not stored
+            allocate(std::max(nextPowerOfTwo(2 * expectedWords), (size_t) 1024));
         }
-        return encodingDictionary;
-    }
 
-    static std::unordered_map<uint32_t, std::string> initializeDecodingDictionary() {
-        std::unordered_map<uint32_t, std::string> decodingDictionary(256);
-        for (int i = 0; i < 256; ++i) {
-            std::string s(1, i);
-            decodingDictionary[i] = s;
+        static uint64_t key(uint32_t prefixCode, uint8_t byte) {
+            return ((uint64_t) prefixCode << 8) | byte;
         }
-        return decodingDictionary;
-    }
+
+        // Returns the slot of the key, which is either holding it or empty
+        size_t find(uint64_t key) const {
+            size_t slot = (key * 0x9E3779B97F4A7C15ull) >> 20 & (capacity - 1);
+            while (keys[slot] != EMPTY_SLOT && keys[slot] != key)
+                slot = (slot + 1) & (capacity - 1);
+            return slot;
+        }
+
+        void insert(size_t slot, uint64_t key) {
+            keys[slot] = key;
+            codes[slot] = size++;
+
+            // Keep the load factor under 1/2
+            if (2 * (size - ALPHABET_SIZE) > capacity)
+                grow();
+        }
+
+        // The primed words take the codes following the single bytes, in their order
+        void prime(const std::vector<uint64_t>& words) {
+            for (uint64_t word : words)
+                insert(find(word), word);
+        }
+
+    private:
+
+        static size_t nextPowerOfTwo(size_t n) {
+            size_t power = 1;
+            while (power < n)
+                power <<= 1;
+            return power;
+        }
+
+        void allocate(size_t newCapacity) {
+            capacity = newCapacity;
+            keys = arena.allocate<uint64_t>(capacity);
+            codes = arena.allocate<uint32_t>(capacity);
+            std::fill(keys, keys + capacity, (uint64_t) EMPTY_SLOT);
+        }
+
+        // The old table stays in the arena until the end of the encoding scope
+        void grow() {
+            uint64_t* oldKeys = keys;
+            uint32_t* oldCodes = codes;
+            size_t oldCapacity = capacity;
+
+            allocate(2 * oldCapacity);
+            for (size_t i = 0; i < oldCapacity; ++i) {
+                if (oldKeys[i] != EMPTY_SLOT) {
+                    size_t slot = find(oldKeys[i]);
+                    keys[slot] = oldKeys[i];
+                    codes[slot] = oldCodes[i];
+                }
+            }
+        }
+    };
+
+    /**
+     * Each word is stored as its prefix word and its last byte, it is written backwards by following the prefixes
+     */
+    struct DecodingDictionary {
+        uint32_t* prefixes;
+        uint8_t* lastBytes;
+        uint8_t* firstBytes;
+        uint32_t* lengths;
+        uint32_t size; // Number of words including the single bytes
+
+        DecodingDictionary(ScratchArena& arena, size_t maximumWords) {
+            prefixes = arena.allocate<uint32_t>(maximumWords);
+            lastBytes = arena.allocate<uint8_t>(maximumWords);
+            firstBytes = arena.allocate<uint8_t>(maximumWords);
+            lengths = arena.allocate<uint32_t>(maximumWords);
+
+            for (uint32_t i = 0; i < ALPHABET_SIZE; ++i) {
+                lastBytes[i] = firstBytes[i] = i;
+                lengths[i] = 1;
+            }
+            size = ALPHABET_SIZE;
+        }
+
+        void add(uint32_t prefixCode, uint8_t byte) {
+            prefixes[size] = prefixCode;
+            lastBytes[size] = byte;
+            firstBytes[size] = firstBytes[prefixCode];
+            lengths[size] = lengths[prefixCode] + 1;
+            size++;
+        }
+
+        void prime(const std::vector<uint64_t>& words) {
+            for (uint64_t word : words)
+                add(word >> BYTE, word & 0xFF);
+        }
+
+        // Writes the word to [output] which must have room for lengths[code] bytes
+        void write(uint32_t code, uint8_t* output) const {
+            for (uint32_t i = lengths[code]; i > 0; --i) {
+                output[i - 1] = lastBytes[code];
+                code = prefixes[code];
+            }
+        }
+    };
+
+    /**
+     * Adapts bit_string to the interface of BitWriter, for the file format
+     */
+    struct BitStringWriter {
+        bit_string& bits;
+
+        void write(uint32_t value, uint32_t numberOfBits) {
+            bits.append_uint_32(value, numberOfBits);
+        }
+
+        template<uint32_t WIDTH>
+        void writeRun(const uint32_t* values, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                write(values[i], WIDTH);
+        }
+    };
+
+    /**
+     * Adapts bit_string to the interface of BitReader, for the file format
+     */
+    struct BitStringReader {
+        const bit_string& bits;
+        size_t position;
+
+        uint32_t read(uint32_t numberOfBits) {
+            uint32_t value = bits.substr(position, numberOfBits).to_uint_32();
+            position += numberOfBits;
+            return value;
+        }
+
+        template<uint32_t WIDTH>
+        void readRun(uint32_t* values, size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                values[i] = read(WIDTH);
+        }
+
+        size_t remaining() const {
+            return bits.length() - position;
+        }
+    };
+
+    /**
+     * Codes waiting to be written, all of the same width, so they are packed by the kernel of that width
+     */
+    template<typename BitSink>
+    struct PendingCodes {
+        BitSink& output;
+        uint32_t codes[RUN_SIZE];
+        size_t count = 0;
+        uint32_t width = 0;
+
+        explicit PendingCodes(BitSink& output) : output(output) {}
+
+        void write(uint32_t code, uint32_t codeWidth) {
+            if (codeWidth != width || count == RUN_SIZE) {
+                flush();
+                width = codeWidth;
+            }
+            codes[count++] = code;
+        }
+
+        void flush() {
+            if (count > 0)
+                CodeRuns<>::write(output, width, codes, count);
+            count = 0;
+        }
+    };
+
+    /**
+     * Grows the output string as words are decoded, for the file format where the decoded size is unknown
+     */
+    struct StringSink {
+        std::string& data;
+
+        uint8_t* claim(size_t length) {
+            size_t position = data.size();
+            data.resize(position + length);
+            return (uint8_t*) &data[position];
+        }
+    };
 
 public:
 
+    /**
+     * Words both dictionaries start with besides the single bytes, learnt once from a trained content <br>
+     * Small inputs then use codes of words they would otherwise have to learn first,
+     * priming only inserts the words, the content is not matched again
+     */
+    class Primer {
+        friend class LZW;
 
-    static void encode(const std::string& filename, const std::string& outputFileName) {
+        // Keys (code of the prefix, last byte) of the words, in the order of their codes
+        std::vector<uint64_t> words;
 
-        auto dictionary = initializeEncodingDictionary();
+    public:
+        Primer() = default;
 
-        std::string toBeCompressed = BinaryIO::readString(filename);
-        bit_string encodedData;
-        encodedData.reserve(toBeCompressed.size() / (4 * BYTE));
+        // Learns the words an encoding of [content] would add to the dictionary
+        Primer(const uint8_t* content, size_t length) {
+            ScratchArena arena;
+            EncodingDictionary dictionary(arena, length);
 
+            uint32_t currentMatch = 0;
+            for (size_t i = 0; i < length; ++i) {
+                if (i == 0) {
+                    currentMatch = content[i];
+                    continue;
+                }
+
+                uint64_t key = EncodingDictionary::key(currentMatch, content[i]);
+                size_t slot = dictionary.find(key);
+                if (dictionary.keys[slot] == EMPTY_SLOT) {
+                    dictionary.insert(slot, key);
+                    words.push_back(key);
+                    currentMatch = content[i];
+                } else {
+                    currentMatch = dictionary.codes[slot];
+                }
+            }
+        }
+
+        size_t size() const {
+            return words.size();
+        }
+    };
+
+    /**
+     * Decoded words are written to a caller provided buffer
+     */
+    struct BufferSink {
+        uint8_t* data;
+        size_t capacity;
+        size_t size;
+
+        BufferSink(uint8_t* data, size_t capacity) : data(data), capacity(capacity), size(0) {}
+
+        // Returns where to write the next [length] bytes, or nullptr if they do not fit
+        uint8_t* claim(size_t length) {
+            if (capacity - size < length)
+                return nullptr;
+            uint8_t* position = data + size;
+            size += length;
+            return position;
+        }
+    };
+
+
+    /**
+     * Encoding context, owns the memory of the dictionary so consecutive blocks reuse it <br>
+     * Independent encoders can run concurrently, a single one must not be shared between threads
+     */
+    class Encoder {
+        ScratchArena ownArena;
+        ScratchArena& arena;
+
+    public:
+        Encoder() : arena(ownArena) {}
+
+        // Uses the memory of a bigger pipeline instead of its own
+        explicit Encoder(ScratchArena& sharedArena) : arena(sharedArena) {}
+
+        template<typename BitSink>
+        void encode(const uint8_t* input, size_t length, BitSink& output, const Primer* primer = nullptr) {
+            LZW::encode(input, length, output, arena, primer);
+        }
+    };
+
+    /**
+     * Decoding context, owns the memory of the dictionary so consecutive blocks reuse it <br>
+     * Independent decoders can run concurrently, a single one must not be shared between threads
+     */
+    class Decoder {
+        ScratchArena ownArena;
+        ScratchArena& arena;
+
+    public:
+        Decoder() : arena(ownArena) {}
+
+        // Uses the memory of a bigger pipeline instead of its own
+        explicit Decoder(ScratchArena& sharedArena) : arena(sharedArena) {}
+
+        template<typename BitSource, typename ByteSink>
+        bool decode(BitSource& input, ByteSink& output, const Primer* primer = nullptr) {
+            return LZW::decode(input, output, arena, primer);
+        }
+    };
+
+
+    /**
+     * Writes the codes of [input] to [output] (BitWriter or any type with the same write function) <br>
+     * The decoder must be given the same [primer]
+     */
+    template<typename BitSink>
+    static void encode(const uint8_t* input, size_t length, BitSink& output,
+                       ScratchArena& arena = ScratchArena::forCurrentThread(), const Primer* primer = nullptr) {
+
+        ScratchArena::Scope scope(arena);
+        EncodingDictionary dictionary(arena, length / 2 + (primer != nullptr ? primer->size() : 0));
+        if (primer != nullptr)
+            dictionary.prime(primer->words);
+
+        PendingCodes<BitSink> pendingCodes(output);
         uint32_t currentWordLength;
-        std::string currentMatch;
-        for (uint8_t byte : toBeCompressed) {
-            currentMatch += byte;
+        uint32_t currentMatch = 0;
+        bool hasMatch = false;
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t byte = input[i];
+
+            if (!hasMatch) {
+                currentMatch = byte;
+                hasMatch = true;
+                continue;
+            }
+
+            uint64_t key = EncodingDictionary::key(currentMatch, byte);
+            size_t slot = dictionary.find(key);
 
             // if not found in dictionary
-            if (dictionary.find(currentMatch) == dictionary.end()) {
-                dictionary[currentMatch] = dictionary.size();
-                currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size());
-                currentMatch.pop_back();
-                encodedData.append_uint_32(dictionary[currentMatch], currentWordLength);
+            if (dictionary.keys[slot] == EMPTY_SLOT) {
+                dictionary.insert(slot, key);
+                currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size);
+                pendingCodes.write(currentMatch, currentWordLength);
                 currentMatch = byte;
+            } else {
+                currentMatch = dictionary.codes[slot];
             }
 
         }
 
-        // save last matched word
-        currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size());
-        encodedData.append_uint_32(dictionary[currentMatch], currentWordLength);
-
-        remove(outputFileName.c_str()); // Remove Output File If Exists
-        BinaryIO::write(outputFileName, encodedData);
+        // save last matched word, with the same width the decoder expects for its next word
+        if (hasMatch) {
+            currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size + 1);
+            pendingCodes.write(currentMatch, currentWordLength);
+        }
+        pendingCodes.flush();
     }
 
 
-    static void decode(const std::string& filename, const std::string& outputFileName) {
+    /**
+     * Decodes all the codes in [input] (BitReader or alike) to [output] (BufferSink or alike) <br>
+     * Returns false if the data is corrupted or does not fit in the output
+     */
+    template<typename BitSource, typename ByteSink>
+    static bool decode(BitSource& input, ByteSink& output, ScratchArena& arena = ScratchArena::forCurrentThread(),
+                       const Primer* primer = nullptr) {
 
-        auto dictionary = initializeDecodingDictionary();
+        ScratchArena::Scope scope(arena);
 
-        bit_string toBeDecompressed = BinaryIO::readBitString(filename);
+        // Every word takes at least 9 bits, and adds at most one new word
+        size_t primedWords = primer != nullptr ? primer->size() : 0;
+        DecodingDictionary dictionary(arena, ALPHABET_SIZE + primedWords + input.remaining() / (BYTE + 1) + 1);
+        if (primer != nullptr)
+            dictionary.prime(primer->words);
 
-        std::string decoded;
-        decoded.reserve(toBeDecompressed.size()/BYTE);
-        uint32_t currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size());
-        for (int i = 0; i < toBeDecompressed.length(); i += currentWordLength) {
+        uint32_t codes[RUN_SIZE];
+        uint32_t previousIndex = 0;
+        bool isFirstWord = true;
+        while (true) {
+
+            // The word being built from the previous one is counted, as the encoder did
+            uint32_t dictionarySize = dictionary.size + !isFirstWord;
+
+            // Each code adds a word, so the width only grows once the dictionary size reaches the next power of 2
+            // and the codes until then are unpacked together
+            uint32_t currentWordLength = numberOfBitsToStoreRangeOf(dictionarySize + 1);
+            uint64_t codesOfThisLength = ((uint64_t) 1 << currentWordLength) - dictionarySize;
 
             // The left characters are not enough to create a word
             // i.e. they are garbage to align to bytes
-            if (toBeDecompressed.length() - i < currentWordLength)
+            size_t count = (size_t) std::min<uint64_t>(std::min(codesOfThisLength, (uint64_t) RUN_SIZE),
+                                                       input.remaining() / currentWordLength);
+            if (count == 0)
                 break;
+            CodeRuns<>::read(input, currentWordLength, codes, count);
 
-            currentWordLength = numberOfBitsToStoreRangeOf(dictionary.size() + 1);
+            for (size_t i = 0; i < count; ++i, isFirstWord = false) {
+                uint32_t index = codes[i];
+                dictionarySize = dictionary.size + !isFirstWord;
 
-            uint32_t index = toBeDecompressed.substr(i, currentWordLength).to_uint_32();
+                // Corrupted data, the word does not exist yet
+                if (index >= dictionarySize)
+                    return false;
 
-            // The last char in the previous entry is not added, as its value is the first char of the next entry
-            if (i != 0) {
-                uint8_t lastCharInPreviousEntry = dictionary[index].front();
-                dictionary[dictionary.size() - 1] += lastCharInPreviousEntry;
-            }
+                // The last char in the previous entry is not known until the next entry is read, as it is its first char
+                if (!isFirstWord) {
+                    uint8_t lastCharInPreviousEntry = index == dictionary.size ? dictionary.firstBytes[previousIndex]
+                                                                               : dictionary.firstBytes[index];
+                    dictionary.add(previousIndex, lastCharInPreviousEntry);
+                }
 
-            std::string word = dictionary[index];
-            decoded += word;
-            dictionary[dictionary.size()] = std::move(word);
+                uint8_t* word = output.claim(dictionary.lengths[index]);
+                if (word == nullptr)
+                    return false;
+                dictionary.write(index, word);
 
+                previousIndex = index;
+            }
         }
 
+        return true;
+    }
+
+
+    static void encode(const std::string& filename, const std::string& outputFileName) {
+
+        std::string toBeCompressed = BinaryIO::readString(filename);
+        bit_string encodedData;
+        encodedData.reserve(toBeCompressed.size() / (4 * BYTE));
+
+        BitStringWriter writer = {encodedData};
+        encode((const uint8_t*) toBeCompressed.data(), toBeCompressed.size(), writer);
+
         remove(outputFileName.c_str()); // Remove Output File If Exists
-        BinaryIO::write(outputFileName, decoded);
+        BinaryIO::write(outputFileName, encodedData);
     }
 
 
+    static void decode(const std::string& filename, const std::string& outputFileName) {
+
+        bit_string toBeDecompressed = BinaryIO::readBitString(filename);
+
+        std::string decoded;
+        decoded.reserve(toBeDecompressed.size()/BYTE);
+
+        BitStringReader reader = {toBeDecompressed, 0};
+        StringSink sink = {decoded};
+        decode(reader, sink);
+
+        remove(outputFileName.c_str()); // Remove Output File If Exists
+        BinaryIO::write(outputFileName, decoded);
+    }
+
 };
 
 
@@ -1,6 +1,7 @@
 #ifndef LZW_UTILS_H
 #define LZW_UTILS_H
 
+#include <cstddef>
 #include <cstdint>
 
 #ifdef __GNUC__ // GNU GCC Compiler
@@ -47,4 +48,42 @@ inline uint32_t numberOfBitsToStoreRangeOf(uint32_t n) {
 }
 #endif
 
+/**
+ * Calls the kernel of the bit reader or writer specialized for codes of [width] bits,
+ * WIDTH is the widest one left to compare <br>
+ * Codes come in runs of the same width, so the comparisons are paid once per run instead of once per code
+ */
+template<uint32_t WIDTH = 32>
+struct CodeRuns {
+
+    template<typename BitSource>
+    static void read(BitSource& input, uint32_t width, uint32_t* codes, size_t count) {
+        if (width == WIDTH)
+            input.template readRun<WIDTH>(codes, count);
+        else
+            CodeRuns<WIDTH - 1>::read(input, width, codes, count);
+    }
+
+    template<typename BitSink>
+    static void write(BitSink& output, uint32_t width, const uint32_t* codes, size_t count) {
+        if (width == WIDTH)
+            output.template writeRun<WIDTH>(codes, count);
+        else
+            CodeRuns<WIDTH - 1>::write(output, width, codes, count);
+    }
+
+};
+
+// LZW codes have at least 9 bits, the 256 single bytes and the next word
+template<>
+struct CodeRuns<8> {
+
+    template<typename BitSource>
+    static void read(BitSource&, uint32_t, uint32_t*, size_t) {}
+
+    template<typename BitSink>
+    static void write(BitSink&, uint32_t, const uint32_t*, size_t) {}
+
+};
+
 #endif //LZW_UTILS_H
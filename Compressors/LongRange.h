@@ -0,0 +1,294 @@
+#ifndef LONG_RANGE_H
+#define LONG_RANGE_H
+
+#include <cstdint>
+#include <cstring>
+#include "../Utils/BinaryIO.h"
+#include "../Utils/CPU.h"
+#include "../Utils/ScratchArena.h"
+
+/**
+ * Long range matching (as in rzip), applied to the whole input before it is split in blocks <br>
+ * Repeats of at least MINIMUM_MATCH bytes are replaced by references to their previous occurrence,
+ * however far it is, so repeats between distant blocks are removed and the suffix sort sees less repetitive data.
+ * Repeats with an occurrence nearer than the minimum distance (a block) are left to the BWT, which codes them better
+ *
+ * @Format
+ * Sequence of tokens, each one consists of:
+ *  - Literals Count (Varint) followed by the literals
+ *  - Match Length (Varint) and Match Distance (Varint), missing in the last token
+ */
+class LongRange {
+
+    // Positions are found by the hash of the WINDOW bytes starting at them,
+    // only one position every STRIDE is indexed so every repeat of WINDOW + STRIDE - 1 bytes is found
+    static const uint32_t WINDOW = 32;
+    static const uint32_t STRIDE = 32;
+
+    // The tables have a slot for each indexed position, each one a quarter of the size of the input which is already
+    // in memory, beyond 2^32 slots (inputs of 128 GB) the positions replace each other and far repeats are found less often
+    static const uint32_t MAXIMUM_TABLE_BITS = 32;
+    static const uint64_t PRIME = 0x100000001B3ull;
+
+public:
+
+    // Shorter repeats are left to the BWT, a reference costs up to 3 varints
+    static const uint32_t MINIMUM_MATCH = 128;
+
+    // The encoded size never exceeds the input size by more than this
+    static const size_t MAXIMUM_OVERHEAD = BinaryIO::MAXIMUM_VARINT_SIZE;
+
+    static size_t encodeBound(size_t length) {
+        return length + MAXIMUM_OVERHEAD;
+    }
+
+    /**
+     * Writes the tokens of [input] to [output], which must have room for encodeBound(length) bytes,
+     * the references point [minimumDistance] bytes back at least <br>
+     * Returns the encoded size
+     */
+    static size_t encode(const uint8_t* input, size_t length, uint8_t* output, size_t minimumDistance,
+                         ScratchArena& arena = ScratchArena::forCurrentThread()) {
+
+        ScratchArena::Scope scope(arena);
+
+        // Tables of the indexed positions (plus one, zero is empty) of each hash: the last one, and a far one only
+        // replaced by the positions the minimum distance after it, so the near repeats of runs do not hide it
+        uint32_t tableBits = 10;
+        while (tableBits < MAXIMUM_TABLE_BITS && ((uint64_t) 1 << tableBits) < length / STRIDE)
+            tableBits++;
+        uint64_t* lastTable = arena.allocate<uint64_t>((size_t) 1 << tableBits);
+        uint64_t* farTable = arena.allocate<uint64_t>((size_t) 1 << tableBits);
+        memset(lastTable, 0, sizeof(uint64_t) << tableBits);
+        memset(farTable, 0, sizeof(uint64_t) << tableBits);
+
+        // Removes the first char of the window from the rolling hash
+        uint64_t outgoingFactor = 1;
+        for (uint32_t i = 1; i < WINDOW; ++i)
+            outgoingFactor *= PRIME;
+
+        size_t outputSize = 0;
+        size_t literalsStart = 0;
+        size_t position = 0;
+        uint64_t hash = 0;
+        bool isHashValid = false;
+
+        while (position + WINDOW <= length) {
+            if (!isHashValid) {
+                hash = hashWindow(input + position);
+                isHashValid = true;
+            }
+
+            size_t slotIndex = (hash * PRIME) >> (64 - tableBits);
+            uint64_t& lastSlot = lastTable[slotIndex];
+            uint64_t& slot = farTable[slotIndex];
+            bool isFar = slot == 0 || position - (slot - 1) >= minimumDistance;
+
+            // The window is already in the block when its last position is near, the BWT codes it better
+            bool isNear = lastSlot != 0 && position - (lastSlot - 1) < minimumDistance &&
+                          memcmp(input + lastSlot - 1, input + position, WINDOW) == 0;
+
+            if (slot != 0 && isFar && !isNear && !isPeriodic(input + position, length - position)) {
+                size_t candidate = slot - 1;
+
+                // Extends the match after the window and back over the pending literals
+                size_t forward = matchLength(input + candidate, input + position, length - position);
+
+                size_t backward = 0;
+                while (backward < candidate && position - backward > literalsStart &&
+                       input[candidate - backward - 1] == input[position - backward - 1])
+                    backward++;
+
+                if (forward >= WINDOW && forward + backward >= MINIMUM_MATCH) {
+                    size_t matchStart = position - backward;
+                    size_t matchLength = forward + backward;
+
+                    outputSize += writeLiterals(input + literalsStart, matchStart - literalsStart, output + outputSize);
+                    outputSize += BinaryIO::storeVarint(output + outputSize, matchLength);
+                    outputSize += BinaryIO::storeVarint(output + outputSize, position - candidate);
+
+                    position = matchStart + matchLength;
+                    literalsStart = position;
+                    isHashValid = false;
+                    continue;
+                }
+            }
+
+            if (position % STRIDE == 0) {
+                lastSlot = position + 1;
+                if (isFar)
+                    slot = position + 1;
+            }
+
+            // Rolls the window one char forward
+            if (position + WINDOW < length)
+                hash = (hash - input[position] * outgoingFactor) * PRIME + input[position + WINDOW];
+            position++;
+        }
+
+        outputSize += writeLiterals(input + literalsStart, length - literalsStart, output + outputSize);
+        return outputSize;
+    }
+
+    /**
+     * Writes the original data of the tokens in [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the decoded size, or SIZE_MAX if it does not fit or the input is corrupted
+     */
+    static size_t decode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        const uint8_t* end = input + length;
+        size_t outputSize = 0;
+
+        while (true) {
+            uint64_t literalsCount;
+            if (!BinaryIO::loadVarint(input, end, literalsCount) || literalsCount > (uint64_t) (end - input) ||
+                literalsCount > capacity - outputSize)
+                return SIZE_MAX;
+
+            memcpy(output + outputSize, input, literalsCount);
+            input += literalsCount;
+            outputSize += literalsCount;
+
+            if (input == end)
+                return outputSize;
+
+            uint64_t matchLength, distance;
+            if (!BinaryIO::loadVarint(input, end, matchLength) || !BinaryIO::loadVarint(input, end, distance))
+                return SIZE_MAX;
+            if (distance == 0 || distance > outputSize || matchLength > capacity - outputSize)
+                return SIZE_MAX;
+
+            // The match may overlap the bytes it writes, as in a run
+            uint8_t* destination = output + outputSize;
+            const uint8_t* source = destination - distance;
+            if (distance >= matchLength) {
+                memcpy(destination, source, matchLength);
+            } else {
+                for (uint64_t i = 0; i < matchLength; ++i)
+                    destination[i] = source[i];
+            }
+            outputSize += matchLength;
+        }
+    }
+
+    /**
+     * Size the tokens in [input] decode to, read without decoding them so a corrupted size is seen before allocating <br>
+     * Returns SIZE_MAX if the tokens are corrupted
+     */
+    static size_t decodedSize(const uint8_t* input, size_t length) {
+        const uint8_t* end = input + length;
+        size_t outputSize = 0;
+
+        while (true) {
+            uint64_t literalsCount;
+            if (!BinaryIO::loadVarint(input, end, literalsCount) || literalsCount > (uint64_t) (end - input))
+                return SIZE_MAX;
+
+            input += literalsCount;
+            outputSize += literalsCount;
+            if (input == end)
+                return outputSize;
+
+            uint64_t matchLength, distance;
+            if (!BinaryIO::loadVarint(input, end, matchLength) || !BinaryIO::loadVarint(input, end, distance))
+                return SIZE_MAX;
+            if (distance == 0 || distance > outputSize || matchLength >= SIZE_MAX - outputSize)
+                return SIZE_MAX;
+            outputSize += matchLength;
+        }
+    }
+
+private:
+
+    // Runs and short repeated patterns are coded by the BWT in a few bytes, wherever their previous occurrence is
+    static bool isPeriodic(const uint8_t* window, size_t maximum) {
+        for (uint32_t period = 1; period <= STRIDE && period + WINDOW <= maximum; ++period) {
+            if (memcmp(window, window + period, WINDOW) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static uint64_t hashWindow(const uint8_t* window) {
+        uint64_t hash = 0;
+        for (uint32_t i = 0; i < WINDOW; ++i)
+            hash = hash * PRIME + window[i];
+        return hash;
+    }
+
+    /**
+     * Number of equal bytes at the start of [first] and [second], up to [maximum] <br>
+     * Matches are hundreds of bytes long or more, so they are compared 16, 32 or 64 bytes at a time when the CPU can
+     */
+    static size_t matchLength(const uint8_t* first, const uint8_t* second, size_t maximum) {
+#ifdef CPU_HAS_X86
+        switch (CPU::active()) {
+            case CPU::Level::AVX512:
+                return matchLengthAVX512(first, second, maximum);
+            case CPU::Level::AVX2:
+                return matchLengthAVX2(first, second, maximum);
+            case CPU::Level::SSE42:
+                return matchLengthSSE42(first, second, maximum);
+            default:
+                break;
+        }
+#endif
+        return matchLengthScalar(first, second, maximum);
+    }
+
+    static size_t matchLengthScalar(const uint8_t* first, const uint8_t* second, size_t maximum) {
+        size_t length = 0;
+        while (length < maximum && first[length] == second[length])
+            length++;
+        return length;
+    }
+
+#ifdef CPU_HAS_X86
+    // The bytes left after the last full compare are compared one by one
+
+    CPU_TARGET_SSE42
+    static size_t matchLengthSSE42(const uint8_t* first, const uint8_t* second, size_t maximum) {
+        size_t length = 0;
+        for (; maximum - length >= 16; length += 16) {
+            uint32_t equal = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (first + length)),
+                                                              _mm_loadu_si128((const __m128i*) (second + length))));
+            if (equal != 0xFFFF)
+                return length + CPU::lowestSetBit(~equal);
+        }
+        return length + matchLengthScalar(first + length, second + length, maximum - length);
+    }
+
+    CPU_TARGET_AVX2
+    static size_t matchLengthAVX2(const uint8_t* first, const uint8_t* second, size_t maximum) {
+        size_t length = 0;
+        for (; maximum - length >= 32; length += 32) {
+            uint32_t equal = (uint32_t) _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (first + length)),
+                                      _mm256_loadu_si256((const __m256i*) (second + length))));
+            if (equal != 0xFFFFFFFF)
+                return length + CPU::lowestSetBit(~equal);
+        }
+        return length + matchLengthScalar(first + length, second + length, maximum - length);
+    }
+
+    CPU_TARGET_AVX512
+    static size_t matchLengthAVX512(const uint8_t* first, const uint8_t* second, size_t maximum) {
+        size_t length = 0;
+        for (; maximum - length >= 64; length += 64) {
+            __mmask64 different = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512(first + length),
+                                                           _mm512_loadu_si512(second + length));
+            if (different != 0)
+                return length + CPU::lowestSetBit(different);
+        }
+        return length + matchLengthScalar(first + length, second + length, maximum - length);
+    }
+#endif
+
+    static size_t writeLiterals(const uint8_t* literals, size_t count, uint8_t* output) {
+        size_t size = BinaryIO::storeVarint(output, count);
+        memcpy(output + size, literals, count);
+        return size + count;
+    }
+
+};
+
+#endif //LONG_RANGE_H
@@ -1,49 +1,188 @@
 #ifndef MTF_H
 #define MTF_H
 
-#include <list>
 #include <string>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 #include "../Utils/BinaryIO.h"
-
-/**
- * Wrapper around std::list::iterator
- */
-struct Iterator {
-    std::list<uint8_t>::const_iterator iterator;
-    uint8_t index;
-    uint8_t value;
-
-    Iterator(const std::list<uint8_t>::const_iterator& iterator, uint32_t index) {
-        this->iterator = iterator;
-        this->index = index;
-        this->value = *iterator;
-    }
-};
+#include "../Utils/CPU.h"
+#include "../Utils/Stats.h"
+#include "../Utils/ThreadPool.h"
 
 
 /**
- * Move To Front Algorithm
+ * Move To Front Algorithm <br>
+ * Large blocks can be split in segments coded by the threads of a pool, the output is the same as coding them in one go <br>
+ * The encoder searches the list with SSE4.2, AVX2 or AVX-512 compares when the CPU has them (see CPU.h)
  */
 class MTF {
 
-    static std::list<uint8_t> symbolsList;
+    // The SIMD compares of the encoder start after the front of the list, so the last one reads up to 16 bytes after it
+    static const size_t LIST_PADDING = 16;
 
 public:
 
-    static void encode(const std::string& filename, const std::string& outputFileName) {
+    // Segments coded by different threads are at least this long, so handing them to the pool is worth it
+    static const size_t MINIMUM_SEGMENT_SIZE = 1 << 20;
 
-        std::string toBeEncoded = BinaryIO::readString(filename);
+    /**
+     * Encoding context, owns the list of symbols <br>
+     * The list is kept between calls, so a block can be encoded in several parts until reset() is called
+     */
+    class Encoder {
+        // Fixed size array instead of a linked list, so moving a symbol to the front never allocates
+        uint8_t symbolsList[256 + LIST_PADDING] = {};
+        ThreadPool* helpers = nullptr;
+        double helpersCpuSeconds = 0;
+
+    public:
+        Encoder() {
+            reset();
+        }
+
+        void reset() {
+            generateSymbols(symbolsList);
+        }
 
-        generateSymbols();
+        // Workers encoding the segments of a large block with the calling thread, null to encode it all in the calling thread
+        void setHelpers(ThreadPool* pool) {
+            helpers = pool;
+        }
 
-        for (auto& symbol : toBeEncoded) {
-            auto ptr = getIndexOfValue(symbol);
-            symbol = ptr.index; // Encode in-place
-            symbolsList.erase(ptr.iterator);
-            symbolsList.push_front(ptr.value);
+        // CPU time the helpers spent on the last encode, which the CPU time of the calling thread does not include
+        double helperCpuSeconds() const {
+            return helpersCpuSeconds;
         }
 
+        /**
+         * Encodes [data] in-place <br>
+         * The list at the start of a segment holds the symbols of the previous ones by their last occurrence,
+         * then the symbols they do not have in the order of the list at the start of the block,
+         * so it is found by scanning each segment backwards before encoding them all at once
+         */
+        void encode(uint8_t* data, size_t length) {
+            helpersCpuSeconds = 0;
+            size_t numberOfSegments = segmentsOf(length, helpers);
+            if (numberOfSegments == 1) {
+                encodeSegment(symbolsList, data, length);
+                return;
+            }
+
+            // Moving the symbols of a segment by their last occurrence to the front of its list gives the list at its end
+            std::vector<SymbolsList> recentSymbols(numberOfSegments);
+            std::vector<uint32_t> numberOfRecentSymbols(numberOfSegments);
+            helpersCpuSeconds += runSegments(helpers, numberOfSegments, [&](size_t segment) {
+                size_t begin = segmentBegin(segment, numberOfSegments, length);
+                size_t end = segmentBegin(segment + 1, numberOfSegments, length);
+                numberOfRecentSymbols[segment] = findRecentSymbols(data + begin, end - begin, recentSymbols[segment].symbols);
+            });
+
+            std::vector<SymbolsList> lists(numberOfSegments + 1);
+            memcpy(lists[0].symbols, symbolsList, sizeof(symbolsList));
+            for (size_t segment = 0; segment < numberOfSegments; ++segment)
+                putInFront(lists[segment].symbols, recentSymbols[segment].symbols, numberOfRecentSymbols[segment],
+                           lists[segment + 1].symbols);
+
+            helpersCpuSeconds += runSegments(helpers, numberOfSegments, [&](size_t segment) {
+                size_t begin = segmentBegin(segment, numberOfSegments, length);
+                size_t end = segmentBegin(segment + 1, numberOfSegments, length);
+                encodeSegment(lists[segment].symbols, data + begin, end - begin);
+            });
+            memcpy(symbolsList, lists[numberOfSegments].symbols, sizeof(symbolsList));
+        }
+    };
+
+    /**
+     * Decoding context, owns the list of symbols <br>
+     * The list is kept between calls, so a block can be decoded in several parts until reset() is called
+     */
+    class Decoder {
+        uint8_t symbolsList[256];
+        ThreadPool* helpers = nullptr;
+        double helpersCpuSeconds = 0;
+
+    public:
+        Decoder() {
+            reset();
+        }
+
+        void reset() {
+            generateSymbols(symbolsList);
+        }
+
+        // Workers decoding the segments of a large block with the calling thread, null to decode it all in the calling thread
+        void setHelpers(ThreadPool* pool) {
+            helpers = pool;
+        }
+
+        // CPU time the helpers spent on the last decode, as for the encoder
+        double helperCpuSeconds() const {
+            return helpersCpuSeconds;
+        }
+
+        /**
+         * Decodes [data] in-place <br>
+         * Moves only depend on the indexes, so each segment is decoded to positions in the list at its start,
+         * which is only known once the segments before it are decoded, and these positions are replaced by
+         * the symbols in a second pass
+         */
+        void decode(uint8_t* data, size_t length) {
+            helpersCpuSeconds = 0;
+            size_t numberOfSegments = segmentsOf(length, helpers);
+            if (numberOfSegments == 1) {
+                decodeSegment(symbolsList, data, length);
+                return;
+            }
+
+            // The first segment is decoded from the current list, the others from the list of positions
+            std::vector<SymbolsList> lists(numberOfSegments);
+            memcpy(lists[0].symbols, symbolsList, sizeof(symbolsList));
+            for (size_t segment = 1; segment < numberOfSegments; ++segment)
+                generateSymbols(lists[segment].symbols);
+
+            helpersCpuSeconds += runSegments(helpers, numberOfSegments, [&](size_t segment) {
+                size_t begin = segmentBegin(segment, numberOfSegments, length);
+                size_t end = segmentBegin(segment + 1, numberOfSegments, length);
+                decodeSegment(lists[segment].symbols, data + begin, end - begin);
+            });
+
+            // The list at the end of a segment holds positions in the list at its start, except for the first one
+            std::vector<SymbolsList> startLists(numberOfSegments + 1);
+            startLists[1] = lists[0];
+            for (size_t segment = 1; segment < numberOfSegments; ++segment) {
+                for (uint32_t i = 0; i < 256; ++i)
+                    startLists[segment + 1].symbols[i] = startLists[segment].symbols[lists[segment].symbols[i]];
+            }
+
+            helpersCpuSeconds += runSegments(helpers, numberOfSegments - 1, [&](size_t segment) {
+                size_t begin = segmentBegin(segment + 1, numberOfSegments, length);
+                size_t end = segmentBegin(segment + 2, numberOfSegments, length);
+                const uint8_t* symbols = startLists[segment + 1].symbols;
+                for (size_t i = begin; i < end; ++i)
+                    data[i] = symbols[data[i]];
+            });
+            memcpy(symbolsList, startLists[numberOfSegments].symbols, sizeof(symbolsList));
+        }
+    };
+
+    // Encodes [data] in-place
+    static void encode(uint8_t* data, size_t length) {
+        Encoder().encode(data, length);
+    }
+
+    // Decodes [data] in-place
+    static void decode(uint8_t* data, size_t length) {
+        Decoder().decode(data, length);
+    }
+
+    static void encode(const std::string& filename, const std::string& outputFileName) {
+
+        std::string toBeEncoded = BinaryIO::readString(filename);
+
+        encode((uint8_t*) &toBeEncoded[0], toBeEncoded.size());
+
         remove(outputFileName.c_str()); // Remove Output File If Exists
         BinaryIO::write(outputFileName, toBeEncoded);
 
@@ -53,15 +192,7 @@ public:
 
         std::string toBeDecoded = BinaryIO::readString(filename);
 
-        generateSymbols();
-
-        for (auto& byte : toBeDecoded) {
-            uint8_t index = byte;
-            auto ptr = getValueOfIndex(index);
-            byte = ptr.value; // Decode in-place
-            symbolsList.erase(ptr.iterator);
-            symbolsList.push_front(ptr.value);
-        }
+        decode((uint8_t*) &toBeDecoded[0], toBeDecoded.size());
 
         remove(outputFileName.c_str()); // Remove Output File If Exists
         BinaryIO::write(outputFileName, toBeDecoded);
@@ -70,36 +201,196 @@ public:
 
 private:
 
-    static void generateSymbols() {
-        symbolsList.clear();
-        for (uint32_t i = 0; i < 256; ++i) {
-            symbolsList.push_back(i);
+    // Wraps a list, so lists of several segments can be held in a vector
+    struct SymbolsList {
+        uint8_t symbols[256 + LIST_PADDING];
+    };
+
+    static void encodeSegment(uint8_t* symbolsList, uint8_t* data, size_t length) {
+#ifdef CPU_HAS_X86
+        switch (CPU::active()) {
+            case CPU::Level::AVX512:
+                return encodeSegmentAVX512(symbolsList, data, length);
+            case CPU::Level::AVX2:
+                return encodeSegmentAVX2(symbolsList, data, length);
+            case CPU::Level::SSE42:
+                return encodeSegmentSSE42(symbolsList, data, length);
+            default:
+                break;
+        }
+#endif
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t value = data[i];
+            uint8_t index = getIndexOfValue(symbolsList, value);
+            data[i] = index;
+            moveToFront(symbolsList, index, value);
         }
     }
 
-    static Iterator getIndexOfValue(uint8_t c) {
+#ifdef CPU_HAS_X86
+    /**
+     * The recent symbols are found byte by byte in the front of the list, and the others by SIMD compares after it
+     * (the bytes read after the list never match, the symbol is found before them) <br>
+     * Wide loads of the front would wait for the bytes the previous move just stored, which costs more than the search
+     */
+    static const uint32_t FRONT_SIZE = 16;
+
+    // Index of [value] in the FRONT_SIZE first symbols of the list, or FRONT_SIZE if it is further
+    static uint32_t findInFront(const uint8_t* symbolsList, uint8_t value) {
         uint32_t index = 0;
-        for (auto iter = symbolsList.begin(); iter != symbolsList.end(); ++iter) {
-            if (*iter == c)
-                return {iter, index};
+        while (index < FRONT_SIZE && symbolsList[index] != value)
             index++;
+        return index;
+    }
+
+    CPU_TARGET_SSE42
+    static void encodeSegmentSSE42(uint8_t* symbolsList, uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t value = data[i];
+            uint32_t index = findInFront(symbolsList, value);
+            if (index == FRONT_SIZE) {
+                __m128i wanted = _mm_set1_epi8((char) value);
+                uint32_t found;
+                while ((found = _mm_movemask_epi8(
+                        _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (symbolsList + index)), wanted))) == 0)
+                    index += 16;
+                index += CPU::lowestSetBit(found);
+            }
+
+            data[i] = index;
+            moveToFront(symbolsList, index, value);
+        }
+    }
+
+    CPU_TARGET_AVX2
+    static void encodeSegmentAVX2(uint8_t* symbolsList, uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t value = data[i];
+            uint32_t index = findInFront(symbolsList, value);
+            if (index == FRONT_SIZE) {
+                __m256i wanted = _mm256_set1_epi8((char) value);
+                uint32_t found;
+                while ((found = (uint32_t) _mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (symbolsList + index)), wanted))) == 0)
+                    index += 32;
+                index += CPU::lowestSetBit(found);
+            }
+
+            data[i] = index;
+            moveToFront(symbolsList, index, value);
+        }
+    }
+
+    CPU_TARGET_AVX512
+    static void encodeSegmentAVX512(uint8_t* symbolsList, uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t value = data[i];
+            uint32_t index = findInFront(symbolsList, value);
+            if (index == FRONT_SIZE) {
+                __m512i wanted = _mm512_set1_epi8((char) value);
+                __mmask64 found;
+                while ((found = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(symbolsList + index), wanted)) == 0)
+                    index += 64;
+                index += CPU::lowestSetBit(found);
+            }
+
+            data[i] = index;
+            moveToFront(symbolsList, index, value);
         }
-        return {std::list<uint8_t>::const_iterator(), 0};
     }
+#endif
 
-    static Iterator getValueOfIndex(uint32_t requiredIndex) {
+    static void decodeSegment(uint8_t* symbolsList, uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t index = data[i];
+            uint8_t value = symbolsList[index];
+            data[i] = value;
+            moveToFront(symbolsList, index, value);
+        }
+    }
+
+    // Segments of [length] bytes for the calling thread and [helpers], 1 if it is too short to be split
+    static size_t segmentsOf(size_t length, ThreadPool* helpers) {
+        size_t numberOfThreads = helpers != nullptr ? helpers->size() + 1 : 1;
+        size_t numberOfSegments = std::min(numberOfThreads, length / MINIMUM_SEGMENT_SIZE);
+        return numberOfSegments > 0 ? numberOfSegments : 1;
+    }
+
+    static size_t segmentBegin(size_t segment, size_t numberOfSegments, size_t length) {
+        return (uint64_t) length * segment / numberOfSegments;
+    }
+
+    /**
+     * Runs [code] for each of the [numberOfSegments] segments, the first one in the calling thread
+     * and the others in [helpers] <br>
+     * Returns the CPU time the helpers spent on their segments
+     */
+    template<typename Code>
+    static double runSegments(ThreadPool* helpers, size_t numberOfSegments, const Code& code) {
+        std::vector<std::future<double>> segments;
+        for (size_t segment = 1; segment < numberOfSegments; ++segment) {
+            segments.push_back(helpers->submit([&code, segment]() {
+                double startSeconds = Stats::threadCpuSeconds();
+                code(segment);
+                return Stats::threadCpuSeconds() - startSeconds;
+            }));
+        }
+
+        if (numberOfSegments > 0)
+            code(0);
+
+        double helpersCpuSeconds = 0;
+        for (std::future<double>& cpuSeconds : segments)
+            helpersCpuSeconds += cpuSeconds.get();
+        return helpersCpuSeconds;
+    }
+
+    // Writes the distinct symbols of [data] to [symbols] by their last occurrence, returns their number
+    static uint32_t findRecentSymbols(const uint8_t* data, size_t length, uint8_t* symbols) {
+        bool isFound[256] = {};
+        uint32_t numberOfSymbols = 0;
+        for (size_t i = length; i > 0 && numberOfSymbols < 256; --i) {
+            uint8_t value = data[i - 1];
+            if (!isFound[value]) {
+                isFound[value] = true;
+                symbols[numberOfSymbols++] = value;
+            }
+        }
+        return numberOfSymbols;
+    }
+
+    // Writes to [result] the list [symbolsList] after moving the [numberOfRecent] symbols of [recent] to its front
+    static void putInFront(const uint8_t* symbolsList, const uint8_t* recent, uint32_t numberOfRecent, uint8_t* result) {
+        bool isRecent[256] = {};
+        for (uint32_t i = 0; i < numberOfRecent; ++i) {
+            isRecent[recent[i]] = true;
+            result[i] = recent[i];
+        }
+
+        for (uint32_t i = 0, position = numberOfRecent; i < 256; ++i) {
+            if (!isRecent[symbolsList[i]])
+                result[position++] = symbolsList[i];
+        }
+    }
+
+    static void generateSymbols(uint8_t* symbolsList) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            symbolsList[i] = i;
+        }
+    }
+
+    static uint8_t getIndexOfValue(const uint8_t* symbolsList, uint8_t c) {
         uint32_t index = 0;
-        for (auto iter = symbolsList.begin(); iter != symbolsList.end(); ++iter) {
-            if (index == requiredIndex)
-                return {iter, index};
+        while (symbolsList[index] != c)
             index++;
-        }
-        return {std::list<uint8_t>::const_iterator(), 0};
+        return index;
     }
 
+    static void moveToFront(uint8_t* symbolsList, uint8_t index, uint8_t value) {
+        memmove(symbolsList + 1, symbolsList, index);
+        symbolsList[0] = value;
+    }
 
 };
 
-std::list<uint8_t> MTF::symbolsList;
-
-#endif //MTF_H
\ No newline at end of file
+#endif //MTF_H
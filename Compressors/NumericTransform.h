@@ -0,0 +1,297 @@
+#ifndef NUMERIC_TRANSFORM_H
+#define NUMERIC_TRANSFORM_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * Reversible filters of arrays of fixed size records (integers, floats, telemetry samples) applied to a block
+ * before the BWT <br>
+ * Each value is replaced by its difference (DELTA) or its XOR (XOR, for floats) with the value at the same place
+ * in the previous record, then the bytes are transposed in planes (the first byte of every record, then the second
+ * one...) so the slowly changing fields become long runs of small bytes instead of interleaved byte noise <br>
+ * TRANSPOSE only transposes, the bytes after the last whole record are kept as they are
+ *
+ * @Format
+ * The filter is stored in FILTER_SIZE bytes: Operation << 4 | log2 of the Width (1 Byte), Stride (1 Byte),
+ * the transformed block has the size of the original one
+ */
+class NumericTransform {
+public:
+
+    enum class Operation : uint8_t {
+        NONE, DELTA, XOR, TRANSPOSE,
+        DETECT // only in the options, the filter of each block is chosen from a sample of it
+    };
+
+    struct Filter {
+        Operation operation = Operation::NONE;
+        uint8_t width = 1;  // bytes of each value, 1, 2, 4 or 8 (little endian)
+        uint8_t stride = 1; // bytes of each record, a multiple of the width
+    };
+
+    static const size_t FILTER_SIZE = 2;
+    static const uint32_t MAXIMUM_STRIDE = 255;
+
+    static bool isValid(const Filter& filter) {
+        bool isKnown = filter.operation == Operation::DELTA || filter.operation == Operation::XOR ||
+                       filter.operation == Operation::TRANSPOSE;
+        bool isWidth = filter.width == 1 || filter.width == 2 || filter.width == 4 || filter.width == 8;
+        return isKnown && isWidth && filter.stride > 0 && filter.stride % filter.width == 0;
+    }
+
+    static void storeFilter(uint8_t* output, const Filter& filter) {
+        uint8_t widthBits = filter.width == 8 ? 3 : filter.width == 4 ? 2 : filter.width == 2 ? 1 : 0;
+        output[0] = (uint8_t) ((uint8_t) filter.operation << 4 | widthBits);
+        output[1] = filter.stride;
+    }
+
+    // Returns false if the stored filter is not valid
+    static bool loadFilter(const uint8_t* input, Filter& filter) {
+        filter.operation = (Operation) (input[0] >> 4);
+        filter.width = (uint8_t) (1u << (input[0] & 0x0F));
+        filter.stride = input[1];
+        return (input[0] & 0x0F) <= 3 && isValid(filter);
+    }
+
+    /**
+     * Filter of a text, "none" for NONE, "auto" for DETECT or "delta", "xor" or "transpose" followed by ":STRIDE"
+     * and optionally ":WIDTH" (the widest one dividing the stride by default) <br>
+     * Returns false if it is not valid
+     */
+    static bool parse(const std::string& text, Filter& filter) {
+        if (text == "none") {
+            filter = Filter();
+            return true;
+        }
+
+        if (text == "auto") {
+            filter = Filter();
+            filter.operation = Operation::DETECT;
+            return true;
+        }
+
+        size_t separator = text.find(':');
+        if (separator == std::string::npos)
+            return false;
+
+        std::string operation = text.substr(0, separator);
+        if (operation == "delta")
+            filter.operation = Operation::DELTA;
+        else if (operation == "xor")
+            filter.operation = Operation::XOR;
+        else if (operation == "transpose")
+            filter.operation = Operation::TRANSPOSE;
+        else
+            return false;
+
+        std::string sizes = text.substr(separator + 1);
+        size_t widthSeparator = sizes.find(':');
+        uint64_t stride, width;
+        if (!parseNumber(sizes.substr(0, widthSeparator), stride) || stride == 0 || stride > MAXIMUM_STRIDE)
+            return false;
+        if (widthSeparator == std::string::npos)
+            width = widestWidth((uint32_t) stride);
+        else if (!parseNumber(sizes.substr(widthSeparator + 1), width) || width > 8)
+            return false;
+
+        filter.stride = (uint8_t) stride;
+        filter.width = (uint8_t) width;
+        return isValid(filter);
+    }
+
+    /**
+     * Writes the filtered [input] to [output], both of [length] bytes, [filter] must be valid
+     */
+    static void encode(const uint8_t* input, size_t length, uint8_t* output, const Filter& filter) {
+        switch (filter.width) {
+            case 8:
+                return encodeRecords<uint64_t>(input, length, output, filter);
+            case 4:
+                return encodeRecords<uint32_t>(input, length, output, filter);
+            case 2:
+                return encodeRecords<uint16_t>(input, length, output, filter);
+            default:
+                return encodeRecords<uint8_t>(input, length, output, filter);
+        }
+    }
+
+    /**
+     * Inverse of encode, [filter] must be valid
+     */
+    static void decode(const uint8_t* input, size_t length, uint8_t* output, const Filter& filter) {
+        switch (filter.width) {
+            case 8:
+                return decodeRecords<uint64_t>(input, length, output, filter);
+            case 4:
+                return decodeRecords<uint32_t>(input, length, output, filter);
+            case 2:
+                return decodeRecords<uint16_t>(input, length, output, filter);
+            default:
+                return decodeRecords<uint8_t>(input, length, output, filter);
+        }
+    }
+
+    /**
+     * Filter giving the byte planes of lowest entropy to a [sample] of a block, among the usual strides
+     * with every operation and width <br>
+     * Returns a filter of operation NONE if none of them is clearly below the entropy of the raw bytes,
+     * the entropy does not see the contexts of the BWT so the caller should still check the filter on the sample
+     */
+    static Filter detect(const uint8_t* sample, size_t length) {
+        // The common sizes of records of 1 to 4 values, a filter must save 10% of the entropy of the raw bytes
+        static const uint8_t DETECTED_STRIDES[] = {1, 2, 3, 4, 6, 8, 12, 16, 24, 32};
+        Filter best;
+        double bestCost = 0.9 * planesEntropy(sample, length, 1);
+
+        std::vector<uint8_t> filtered(length);
+        for (uint8_t stride : DETECTED_STRIDES) {
+            if ((size_t) stride * 16 > length)
+                break;
+
+            for (Operation operation : {Operation::TRANSPOSE, Operation::XOR, Operation::DELTA}) {
+                for (uint8_t width = 1; width <= 8; width *= 2) {
+                    Filter filter;
+                    filter.operation = operation;
+                    filter.stride = stride;
+                    // Only the delta depends on the width, the others take the fastest one
+                    filter.width = operation == Operation::DELTA ? width : widestWidth(stride);
+                    if (!isValid(filter) || (operation == Operation::TRANSPOSE && stride == 1) ||
+                        (operation != Operation::DELTA && width > 1))
+                        continue;
+
+                    encode(sample, length, filtered.data(), filter);
+                    double cost = planesEntropy(filtered.data(), length, stride);
+                    if (cost < bestCost) {
+                        best = filter;
+                        bestCost = cost;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+
+    static uint8_t widestWidth(uint32_t stride) {
+        return (uint8_t) (stride % 8 == 0 ? 8 : stride % 4 == 0 ? 4 : stride % 2 == 0 ? 2 : 1);
+    }
+
+    static bool parseNumber(const std::string& text, uint64_t& number) {
+        if (text.empty() || text.size() > 3)
+            return false;
+
+        number = 0;
+        for (char digit : text) {
+            if (digit < '0' || digit > '9')
+                return false;
+            number = number * 10 + (digit - '0');
+        }
+        return true;
+    }
+
+    template<typename T>
+    static T loadValue(const uint8_t* data) {
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+            value |= (T) ((T) data[i] << (8 * i));
+        return value;
+    }
+
+    template<typename T>
+    static void storeValue(uint8_t* data, T value) {
+        for (size_t i = 0; i < sizeof(T); ++i)
+            data[i] = (uint8_t) (value >> (8 * i));
+    }
+
+    /**
+     * Filters the records one after the other, so the previous record is still in the cache,
+     * the planes are written as [stride] sequential streams
+     */
+    template<typename T>
+    static void encodeRecords(const uint8_t* input, size_t length, uint8_t* output, const Filter& filter) {
+        const uint32_t stride = filter.stride;
+        const size_t numberOfRecords = length / stride;
+
+        for (size_t record = 0; record < numberOfRecords; ++record) {
+            const uint8_t* values = input + record * stride;
+            for (uint32_t offset = 0; offset < stride; offset += sizeof(T)) {
+                T value = loadValue<T>(values + offset);
+                T previous = record > 0 ? loadValue<T>(values - stride + offset) : 0;
+                T coded = filter.operation == Operation::DELTA ? (T) (value - previous)
+                        : filter.operation == Operation::XOR ? (T) (value ^ previous) : value;
+
+                uint8_t* plane = output + offset * numberOfRecords + record;
+                for (size_t i = 0; i < sizeof(T); ++i)
+                    plane[i * numberOfRecords] = (uint8_t) (coded >> (8 * i));
+            }
+        }
+
+        size_t tail = numberOfRecords * stride;
+        if (tail < length)
+            memcpy(output + tail, input + tail, length - tail);
+    }
+
+    template<typename T>
+    static void decodeRecords(const uint8_t* input, size_t length, uint8_t* output, const Filter& filter) {
+        const uint32_t stride = filter.stride;
+        const size_t numberOfRecords = length / stride;
+
+        for (size_t record = 0; record < numberOfRecords; ++record) {
+            uint8_t* values = output + record * stride;
+            for (uint32_t offset = 0; offset < stride; offset += sizeof(T)) {
+                const uint8_t* plane = input + offset * numberOfRecords + record;
+                T coded = 0;
+                for (size_t i = 0; i < sizeof(T); ++i)
+                    coded |= (T) ((T) plane[i * numberOfRecords] << (8 * i));
+
+                T previous = record > 0 ? loadValue<T>(values - stride + offset) : 0;
+                T value = filter.operation == Operation::DELTA ? (T) (coded + previous)
+                        : filter.operation == Operation::XOR ? (T) (coded ^ previous) : coded;
+                storeValue<T>(values + offset, value);
+            }
+        }
+
+        size_t tail = numberOfRecords * stride;
+        if (tail < length)
+            memcpy(output + tail, input + tail, length - tail);
+    }
+
+    // Bits needed to code each of the [stride] planes of [data] with the frequencies of its own bytes
+    static double planesEntropy(const uint8_t* data, size_t length, uint32_t stride) {
+        size_t numberOfRecords = length / stride;
+        double bits = 0;
+        for (uint32_t plane = 0; plane < stride; ++plane) {
+            bool isTransposed = stride > 1;
+            uint32_t counts[256] = {};
+            for (size_t i = 0; i < numberOfRecords; ++i)
+                counts[data[isTransposed ? plane * numberOfRecords + i : i]]++;
+            bits += entropy(counts, numberOfRecords);
+        }
+        return bits;
+    }
+
+    // With the Miller-Madow correction, small planes (of long strides) would look better than they are without it
+    static double entropy(const uint32_t* counts, size_t total) {
+        if (total == 0)
+            return 0;
+
+        double bits = (double) total * std::log2((double) total);
+        uint32_t usedBytes = 0;
+        for (uint32_t byte = 0; byte < 256; ++byte) {
+            if (counts[byte] > 0) {
+                bits -= counts[byte] * std::log2((double) counts[byte]);
+                usedBytes++;
+            }
+        }
+        return bits + (usedBytes - 1) / (2 * std::log(2.0));
+    }
+
+};
+
+#endif //NUMERIC_TRANSFORM_H
@@ -0,0 +1,82 @@
+#ifndef RLE_H
+#define RLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Run Length Encoding applied before the BWT (as the first RLE of bzip2) <br>
+ * Runs of 4 to 255 equal bytes are written as 4 bytes followed by the number of remaining repeats,
+ * so long runs never reach the suffix sort, whose recursion goes as deep as the longest repeat
+ */
+class RLE {
+
+    static const uint32_t MINIMUM_RUN = 4;
+    static const uint32_t MAXIMUM_RUN = MINIMUM_RUN + 251;
+
+public:
+
+    /**
+     * Writes the encoding of [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the encoded size, or SIZE_MAX as soon as it does not fit
+     */
+    static size_t encode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        size_t outputSize = 0;
+
+        for (size_t i = 0; i < length;) {
+            uint8_t value = input[i];
+            uint32_t run = 1;
+            while (i + run < length && run < MAXIMUM_RUN && input[i + run] == value)
+                run++;
+            i += run;
+
+            uint32_t written = run < MINIMUM_RUN ? run : MINIMUM_RUN + 1;
+            if (capacity - outputSize < written)
+                return SIZE_MAX;
+
+            for (uint32_t j = 0; j < written && j < MINIMUM_RUN; ++j)
+                output[outputSize++] = value;
+            if (run >= MINIMUM_RUN)
+                output[outputSize++] = run - MINIMUM_RUN;
+        }
+
+        return outputSize;
+    }
+
+    /**
+     * Writes the original bytes of [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the decoded size, or SIZE_MAX if it does not fit or the input is corrupted
+     */
+    static size_t decode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        size_t outputSize = 0;
+        uint32_t run = 0;
+
+        for (size_t i = 0; i < length; ++i) {
+            uint8_t value = input[i];
+            run = outputSize > 0 && output[outputSize - 1] == value ? run + 1 : 1;
+
+            if (outputSize == capacity)
+                return SIZE_MAX;
+            output[outputSize++] = value;
+
+            // The 4th equal byte is followed by the number of remaining repeats
+            if (run == MINIMUM_RUN) {
+                if (++i == length)
+                    return SIZE_MAX;
+
+                uint32_t repeats = input[i];
+                if (repeats > MAXIMUM_RUN - MINIMUM_RUN || capacity - outputSize < repeats)
+                    return SIZE_MAX;
+
+                for (uint32_t j = 0; j < repeats; ++j)
+                    output[outputSize++] = value;
+                run = 0;
+            }
+        }
+
+        return outputSize;
+    }
+
+};
+
+#endif //RLE_H
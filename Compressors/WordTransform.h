@@ -0,0 +1,356 @@
+#ifndef WORD_TRANSFORM_H
+#define WORD_TRANSFORM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../Utils/BinaryIO.h"
+
+/**
+ * Word replacing transform (as in XWRT) applied to text blocks before the BWT <br>
+ * The frequent words of the block get codes of 1 to 3 bytes by decreasing frequency, stored with the block,
+ * and capitalized words are coded as a flag followed by the code of the lower case word,
+ * so the suffix sort and the next stages see a shorter input where every form of a word has the same code <br>
+ * Words are runs of ASCII letters, the bytes of the codes and the flags are the ones above 127,
+ * so they are escaped where they appear in the block
+ *
+ * @Format
+ * Number of words of the dictionary (Varint), then each word in lower case followed by a zero byte,
+ * then the text where each word of the dictionary is replaced by its code
+ */
+class WordTransform {
+
+    // Codes are made of the bytes CODE_FIRST to CODE_FIRST + CODE_BYTES - 1, the first one tells their length
+    static const uint8_t CODE_FIRST = 0x80;
+    static const uint32_t CODE_BYTES = 125;
+    static const uint32_t ONE_BYTE_CODES = 100;
+    static const uint32_t TWO_BYTES_LEADS = 20;
+    static const uint32_t THREE_BYTES_LEADS = CODE_BYTES - ONE_BYTE_CODES - TWO_BYTES_LEADS;
+    static const uint32_t TWO_BYTES_CODES = TWO_BYTES_LEADS * CODE_BYTES;
+    static const uint32_t MAXIMUM_WORDS = ONE_BYTE_CODES + TWO_BYTES_CODES + THREE_BYTES_LEADS * CODE_BYTES * CODE_BYTES;
+
+    // Flags before a code, and the escape before a literal byte above 127
+    static const uint8_t CAPITAL = 0xFD; // the first letter is a capital one
+    static const uint8_t UPPER = 0xFE;   // all the letters are capital ones
+    static const uint8_t ESCAPE = 0xFF;
+
+    static const uint32_t MINIMUM_WORD_LENGTH = 2;
+    static const uint32_t MAXIMUM_WORD_LENGTH = 64;
+
+    static const uint32_t NOT_CODED = UINT32_MAX;
+
+    enum Shape {
+        LOWER, CAPITALIZED, UPPERCASE, MIXED
+    };
+
+    struct Word {
+        uint32_t offset; // of its first occurrence in the input
+        uint32_t length;
+        uint32_t count;
+        uint32_t rank;   // of its code, NOT_CODED if it is not in the dictionary
+    };
+
+public:
+
+    /**
+     * Writes the transform of [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the transformed size, or SIZE_MAX as soon as it does not fit
+     */
+    static size_t encode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        WordTable table;
+        for (size_t i = 0; i < length;) {
+            size_t end = wordEnd(input, length, i);
+            if (end == i) {
+                i++;
+                continue;
+            }
+
+            if (isCandidate(input + i, end - i))
+                table.find(input, i, end - i).count++;
+            i = end;
+        }
+
+        // The most frequent words get the shortest codes, a word is kept if its codes save more than it takes to store it
+        std::vector<Word*> candidates;
+        for (Word& word : table.words)
+            candidates.push_back(&word);
+        std::sort(candidates.begin(), candidates.end(), [](const Word* first, const Word* second) {
+            return first->count != second->count ? first->count > second->count : first->offset < second->offset;
+        });
+
+        std::vector<const Word*> dictionary;
+        for (Word* word : candidates) {
+            uint32_t rank = dictionary.size();
+            if (rank == MAXIMUM_WORDS)
+                break;
+
+            if (word->length > codeLength(rank) &&
+                (uint64_t) word->count * (word->length - codeLength(rank)) > word->length + 1) {
+                word->rank = rank;
+                dictionary.push_back(word);
+            }
+        }
+
+        if (capacity < BinaryIO::MAXIMUM_VARINT_SIZE)
+            return SIZE_MAX;
+        size_t outputSize = BinaryIO::storeVarint(output, dictionary.size());
+        for (const Word* word : dictionary) {
+            if (capacity - outputSize < word->length + 1)
+                return SIZE_MAX;
+            for (uint32_t i = 0; i < word->length; ++i)
+                output[outputSize++] = toLower(input[word->offset + i]);
+            output[outputSize++] = 0;
+        }
+
+        for (size_t i = 0; i < length;) {
+            size_t end = wordEnd(input, length, i);
+            if (end == i) {
+                // A flag, a code and an escape are at most 5 bytes
+                if (capacity - outputSize < 5)
+                    return SIZE_MAX;
+
+                if (input[i] >= CODE_FIRST)
+                    output[outputSize++] = ESCAPE;
+                output[outputSize++] = input[i++];
+                continue;
+            }
+
+            const Word* word = isCandidate(input + i, end - i) ? &table.find(input, i, end - i) : nullptr;
+            if (word != nullptr && word->rank != NOT_CODED) {
+                if (capacity - outputSize < 5)
+                    return SIZE_MAX;
+
+                Shape shape = shapeOf(input + i, end - i);
+                if (shape != LOWER)
+                    output[outputSize++] = shape == CAPITALIZED ? CAPITAL : UPPER;
+                outputSize += storeCode(word->rank, output + outputSize);
+            } else {
+                if (capacity - outputSize < end - i)
+                    return SIZE_MAX;
+
+                memcpy(output + outputSize, input + i, end - i);
+                outputSize += end - i;
+            }
+            i = end;
+        }
+
+        return outputSize;
+    }
+
+    /**
+     * Writes the original bytes of [input] to [output] which can hold [capacity] bytes <br>
+     * Returns the decoded size, or SIZE_MAX if it does not fit or the input is corrupted
+     */
+    static size_t decode(const uint8_t* input, size_t length, uint8_t* output, size_t capacity) {
+        const uint8_t* end = input + length;
+        uint64_t numberOfWords;
+        if (!BinaryIO::loadVarint(input, end, numberOfWords) || numberOfWords > MAXIMUM_WORDS)
+            return SIZE_MAX;
+
+        // Offset of each word in the dictionary, then of the end of the dictionary
+        std::vector<const uint8_t*> words(numberOfWords + 1);
+        for (uint64_t word = 0; word < numberOfWords; ++word) {
+            words[word] = input;
+            while (input < end && isLower(*input) && (size_t) (input - words[word]) < MAXIMUM_WORD_LENGTH)
+                input++;
+
+            if (input == end || *input != 0 || (size_t) (input - words[word]) < MINIMUM_WORD_LENGTH)
+                return SIZE_MAX;
+            input++;
+        }
+        words[numberOfWords] = input;
+
+        size_t outputSize = 0;
+        while (input < end) {
+            uint8_t value = *input++;
+            if (value < CODE_FIRST || value == ESCAPE) {
+                if (value == ESCAPE && (input == end || *input < CODE_FIRST))
+                    return SIZE_MAX;
+                if (outputSize == capacity)
+                    return SIZE_MAX;
+                output[outputSize++] = value == ESCAPE ? *input++ : value;
+                continue;
+            }
+
+            // A flag is followed by a code
+            uint8_t flag = value == CAPITAL || value == UPPER ? value : 0;
+            if (flag != 0) {
+                if (input == end || *input < CODE_FIRST || *input >= CAPITAL)
+                    return SIZE_MAX;
+                value = *input++;
+            }
+
+            uint32_t rank;
+            if (!loadCode(value, input, end, rank) || rank >= numberOfWords)
+                return SIZE_MAX;
+
+            // Each word is followed by its zero byte
+            size_t wordLength = words[rank + 1] - words[rank] - 1;
+            if (capacity - outputSize < wordLength)
+                return SIZE_MAX;
+
+            for (size_t i = 0; i < wordLength; ++i)
+                output[outputSize + i] = flag == UPPER || (flag == CAPITAL && i == 0) ? toUpper(words[rank][i]) : words[rank][i];
+            outputSize += wordLength;
+        }
+
+        return outputSize;
+    }
+
+private:
+
+    /**
+     * Words of the input by their lower case form, in an open addressing table of indexes in [words]
+     */
+    struct WordTable {
+        std::vector<Word> words;
+        std::vector<uint32_t> slots = std::vector<uint32_t>(1 << 10, 0); // index of a word + 1, 0 is empty
+
+        // Adds the word if it is not in the table yet
+        Word& find(const uint8_t* input, size_t offset, size_t length) {
+            if (2 * (words.size() + 1) > slots.size())
+                grow(input);
+
+            size_t mask = slots.size() - 1;
+            for (size_t slot = hash(input + offset, length) & mask;; slot = (slot + 1) & mask) {
+                if (slots[slot] == 0) {
+                    words.push_back({(uint32_t) offset, (uint32_t) length, 0, NOT_CODED});
+                    slots[slot] = words.size();
+                    return words.back();
+                }
+
+                Word& word = words[slots[slot] - 1];
+                if (word.length == length && isSameWord(input + word.offset, input + offset, length))
+                    return word;
+            }
+        }
+
+        void grow(const uint8_t* input) {
+            slots.assign(2 * slots.size(), 0);
+            size_t mask = slots.size() - 1;
+            for (uint32_t i = 0; i < words.size(); ++i) {
+                size_t slot = hash(input + words[i].offset, words[i].length) & mask;
+                while (slots[slot] != 0)
+                    slot = (slot + 1) & mask;
+                slots[slot] = i + 1;
+            }
+        }
+
+        static size_t hash(const uint8_t* word, size_t length) {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < length; ++i)
+                hash = (hash ^ toLower(word[i])) * 16777619u;
+            return hash;
+        }
+
+        static bool isSameWord(const uint8_t* first, const uint8_t* second, size_t length) {
+            for (size_t i = 0; i < length; ++i) {
+                if (toLower(first[i]) != toLower(second[i]))
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    static bool isLower(uint8_t value) {
+        return value >= 'a' && value <= 'z';
+    }
+
+    static bool isUpper(uint8_t value) {
+        return value >= 'A' && value <= 'Z';
+    }
+
+    static uint8_t toLower(uint8_t value) {
+        return isUpper(value) ? value - 'A' + 'a' : value;
+    }
+
+    static uint8_t toUpper(uint8_t value) {
+        return isLower(value) ? value - 'a' + 'A' : value;
+    }
+
+    // End of the run of letters starting at [begin], [begin] if it is not a letter
+    static size_t wordEnd(const uint8_t* input, size_t length, size_t begin) {
+        size_t end = begin;
+        while (end < length && (isLower(input[end]) || isUpper(input[end])))
+            end++;
+        return end;
+    }
+
+    static Shape shapeOf(const uint8_t* word, size_t length) {
+        bool isRestLower = true, isRestUpper = true;
+        for (size_t i = 1; i < length; ++i) {
+            isRestLower &= isLower(word[i]);
+            isRestUpper &= isUpper(word[i]);
+        }
+
+        if (isLower(word[0]))
+            return isRestLower ? LOWER : MIXED;
+        return isRestLower ? CAPITALIZED : (isRestUpper ? UPPERCASE : MIXED);
+    }
+
+    // Words which can be coded, the others (and their forms with mixed capital letters) are left as they are
+    static bool isCandidate(const uint8_t* word, size_t length) {
+        return length >= MINIMUM_WORD_LENGTH && length <= MAXIMUM_WORD_LENGTH && shapeOf(word, length) != MIXED;
+    }
+
+    static uint32_t codeLength(uint32_t rank) {
+        return rank < ONE_BYTE_CODES ? 1 : (rank < ONE_BYTE_CODES + TWO_BYTES_CODES ? 2 : 3);
+    }
+
+    // Writes the code of [rank] to [output], returns its length
+    static uint32_t storeCode(uint32_t rank, uint8_t* output) {
+        if (rank < ONE_BYTE_CODES) {
+            output[0] = CODE_FIRST + rank;
+            return 1;
+        }
+
+        rank -= ONE_BYTE_CODES;
+        if (rank < TWO_BYTES_CODES) {
+            output[0] = CODE_FIRST + ONE_BYTE_CODES + rank / CODE_BYTES;
+            output[1] = CODE_FIRST + rank % CODE_BYTES;
+            return 2;
+        }
+
+        rank -= TWO_BYTES_CODES;
+        output[0] = CODE_FIRST + ONE_BYTE_CODES + TWO_BYTES_LEADS + rank / (CODE_BYTES * CODE_BYTES);
+        output[1] = CODE_FIRST + rank / CODE_BYTES % CODE_BYTES;
+        output[2] = CODE_FIRST + rank % CODE_BYTES;
+        return 3;
+    }
+
+    // Reads the rest of the code starting with [lead], returns false if it is not a code
+    static bool loadCode(uint8_t lead, const uint8_t*& input, const uint8_t* end, uint32_t& rank) {
+        uint32_t leadIndex = lead - CODE_FIRST;
+        if (leadIndex >= CODE_BYTES)
+            return false;
+        if (leadIndex < ONE_BYTE_CODES) {
+            rank = leadIndex;
+            return true;
+        }
+
+        uint32_t numberOfBytes = leadIndex < ONE_BYTE_CODES + TWO_BYTES_LEADS ? 1 : 2;
+        if ((size_t) (end - input) < numberOfBytes)
+            return false;
+
+        uint32_t rest = 0;
+        for (uint32_t i = 0; i < numberOfBytes; ++i) {
+            uint32_t digit = input[i] - CODE_FIRST;
+            if (input[i] < CODE_FIRST || digit >= CODE_BYTES)
+                return false;
+            rest = rest * CODE_BYTES + digit;
+        }
+        input += numberOfBytes;
+
+        if (numberOfBytes == 1)
+            rank = ONE_BYTE_CODES + (leadIndex - ONE_BYTE_CODES) * CODE_BYTES + rest;
+        else
+            rank = ONE_BYTE_CODES + TWO_BYTES_CODES +
+                   (leadIndex - ONE_BYTE_CODES - TWO_BYTES_LEADS) * CODE_BYTES * CODE_BYTES + rest;
+        return true;
+    }
+
+};
+
+#endif //WORD_TRANSFORM_H
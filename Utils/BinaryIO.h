@@ -1,6 +1,7 @@
 #ifndef BINARY_IO_H
 #define BINARY_IO_H
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <bit_string.h>
@@ -9,22 +10,81 @@ namespace BinaryIO {
 
     static const uint32_t BYTE = 8;
 
-    bool doesFileExist(const std::string& filename) {
+    // Little endian integers, used by the headers of the compressed format
+
+    inline void storeUint32(uint8_t* destination, uint32_t value) {
+        for (int i = 0; i < 4; ++i)
+            destination[i] = value >> (i * BYTE);
+    }
+
+    inline void storeUint64(uint8_t* destination, uint64_t value) {
+        for (int i = 0; i < 8; ++i)
+            destination[i] = value >> (i * BYTE);
+    }
+
+    inline uint32_t loadUint32(const uint8_t* source) {
+        uint32_t value = 0;
+        for (int i = 3; i >= 0; --i)
+            value = (value << BYTE) | source[i];
+        return value;
+    }
+
+    inline uint64_t loadUint64(const uint8_t* source) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+            value = (value << BYTE) | source[i];
+        return value;
+    }
+
+    const size_t MAXIMUM_VARINT_SIZE = 10;
+
+    // 7 bits per byte, the high bit is set on all bytes but the last. Returns the number of bytes written
+    inline size_t storeVarint(uint8_t* destination, uint64_t value) {
+        size_t size = 0;
+        while (value >= 0x80) {
+            destination[size++] = (uint8_t) (value | 0x80);
+            value >>= 7;
+        }
+        destination[size++] = (uint8_t) value;
+        return size;
+    }
+
+    // Advances [source], returns false if the varint goes past [end] or does not fit in 64 bits
+    inline bool loadVarint(const uint8_t*& source, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (uint32_t shift = 0; shift < 64 && source < end; shift += 7) {
+            uint8_t byte = *source++;
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if (byte < 0x80)
+                return true;
+        }
+        return false;
+    }
+
+    inline bool doesFileExist(const std::string& filename) {
         std::ifstream input(filename, std::ios::in | std::ios::binary);
         return input.good();
     }
 
-    int getFileSize(std::ifstream& input) {
+    inline int64_t getFileSize(std::ifstream& input) {
         input.seekg(0, std::ios::end);
         return input.tellg();
     }
 
-    int getFileSize(const std::string& filename) {
-        std::ifstream input(filename);
+    inline int64_t getFileSize(const std::string& filename) {
+        std::ifstream input(filename, std::ios::in | std::ios::binary);
         return getFileSize(input);
     }
 
-    std::string readString(const std::string& filename, int startPosition, int length) {
+    // Reads [length] bytes at [position] of an opened file, returns false if they are not all there
+    inline bool read(std::ifstream& input, uint64_t position, uint8_t* output, size_t length) {
+        input.clear();
+        input.seekg(position);
+        input.read((char*) output, length);
+        return (size_t) input.gcount() == length;
+    }
+
+    inline std::string readString(const std::string& filename, int startPosition, int length) {
         std::ifstream input(filename, std::ios::in | std::ios::binary);
         std::string fileData;
         if (input) {
@@ -36,15 +96,15 @@ namespace BinaryIO {
         return fileData;
     }
 
-    std::string readString(const std::string& filename, int startPosition) {
+    inline std::string readString(const std::string& filename, int startPosition) {
         return readString(filename, startPosition, getFileSize(filename) - startPosition);
     }
 
-    std::string readString(const std::string& filename) {
+    inline std::string readString(const std::string& filename) {
         return readString(filename, 0, getFileSize(filename));
     }
 
-    bit_string readBitString(const std::string& filename, int startPosition, int length) {
+    inline bit_string readBitString(const std::string& filename, int startPosition, int length) {
         std::ifstream input(filename, std::ios::in | std::ios::binary);
         bit_string fileData;
         if (input) {
@@ -56,24 +116,31 @@ namespace BinaryIO {
         return fileData;
     }
 
-    bit_string readBitString(const std::string& filename, int startPosition) {
+    inline bit_string readBitString(const std::string& filename, int startPosition) {
         return readBitString(filename, startPosition, getFileSize(filename) - startPosition);
     }
 
-    bit_string readBitString(const std::string& filename) {
+    inline bit_string readBitString(const std::string& filename) {
         return readBitString(filename, 0, getFileSize(filename));
     }
 
 
     // Append binaryData to the end of the file for strings
-    void write(const std::string& filename, const std::string& binaryData) {
+    inline void write(const std::string& filename, const std::string& binaryData) {
         std::ofstream output(filename, std::ios::out | std::ios::binary | std::ios::app);
         output.write(binaryData.c_str(), binaryData.length());
         output.close();
     }
 
-    // Append binaryData to the end of the file for strings
-    void write(const std::string& filename, const bit_string& binaryData) {
+    // Append binaryData to the end of the file for raw buffers
+    inline void write(const std::string& filename, const uint8_t* binaryData, size_t length) {
+        std::ofstream output(filename, std::ios::out | std::ios::binary | std::ios::app);
+        output.write((const char*) binaryData, length);
+        output.close();
+    }
+
+    // Append binaryData to the end of the file for bit strings
+    inline void write(const std::string& filename, const bit_string& binaryData) {
         std::ofstream output(filename, std::ios::out | std::ios::binary | std::ios::app);
         output.write((char*) binaryData.data(), binaryData.length_in_bytes());
         output.close();
@@ -0,0 +1,172 @@
+#ifndef BIT_IO_H
+#define BIT_IO_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Writes variable width values into a caller provided buffer, most significant bit first <br>
+ * The last byte is padded with zeros, as bit_string does when written to a file
+ */
+class BitWriter {
+
+    uint8_t* output;
+    size_t capacity;
+    size_t position = 0;
+    uint64_t buffer = 0;
+    uint32_t bufferedBits = 0;
+    bool overflow = false;
+
+public:
+
+    BitWriter(uint8_t* output, size_t capacity) : output(output), capacity(capacity) {}
+
+    // Writes the lowest [numberOfBits] bits of [value], numberOfBits must not exceed 32
+    void write(uint32_t value, uint32_t numberOfBits) {
+        buffer = (buffer << numberOfBits) | value;
+        bufferedBits += numberOfBits;
+
+        while (bufferedBits >= 8) {
+            bufferedBits -= 8;
+            put(buffer >> bufferedBits);
+        }
+    }
+
+    /**
+     * Writes the lowest [WIDTH] bits of each of the [count] values, same as calling write for each of them <br>
+     * The width is known at compile time, so the loop is unrolled and 4 bytes are stored at once
+     */
+    template<uint32_t WIDTH>
+    void writeRun(const uint32_t* values, size_t count) {
+        static_assert(WIDTH > 0 && WIDTH <= 32, "Values are at most 32 bits");
+
+        for (size_t i = 0; i < count; ++i) {
+            buffer = (buffer << WIDTH) | values[i];
+            bufferedBits += WIDTH;
+
+            if (bufferedBits >= 32) {
+                bufferedBits -= 32;
+                put32((uint32_t) (buffer >> bufferedBits));
+            }
+        }
+    }
+
+    // Pads the last byte and returns the number of bytes written
+    size_t flush() {
+        // writeRun leaves up to 31 bits
+        while (bufferedBits >= 8) {
+            bufferedBits -= 8;
+            put(buffer >> bufferedBits);
+        }
+
+        if (bufferedBits > 0) {
+            put(buffer << (8 - bufferedBits));
+            bufferedBits = 0;
+        }
+        return position;
+    }
+
+    // true if the output did not fit in the buffer
+    bool overflowed() const {
+        return overflow;
+    }
+
+private:
+
+    void put(uint8_t byte) {
+        if (position < capacity)
+            output[position++] = byte;
+        else
+            overflow = true;
+    }
+
+    void put32(uint32_t value) {
+        if (capacity - position >= 4) {
+            output[position] = value >> 24;
+            output[position + 1] = value >> 16;
+            output[position + 2] = value >> 8;
+            output[position + 3] = value;
+            position += 4;
+        } else {
+            for (int shift = 24; shift >= 0; shift -= 8)
+                put(value >> shift);
+        }
+    }
+
+};
+
+
+/**
+ * Reads variable width values written by BitWriter
+ */
+class BitReader {
+
+    const uint8_t* input;
+    size_t lengthInBits;
+    size_t position = 0;
+
+public:
+
+    BitReader(const uint8_t* input, size_t length) : input(input), lengthInBits(length * 8) {}
+
+    // Reads the next [numberOfBits] bits, numberOfBits must not exceed 32 nor the remaining bits
+    uint32_t read(uint32_t numberOfBits) {
+        uint64_t value = 0;
+        uint32_t bitsRead = 0;
+        while (bitsRead < numberOfBits) {
+            uint32_t bitInByte = position % 8;
+            uint32_t available = 8 - bitInByte;
+            uint32_t taken = numberOfBits - bitsRead < available ? numberOfBits - bitsRead : available;
+
+            uint32_t byte = input[position / 8];
+            uint32_t bits = (byte >> (available - taken)) & ((1u << taken) - 1);
+            value = (value << taken) | bits;
+
+            bitsRead += taken;
+            position += taken;
+        }
+        return (uint32_t) value;
+    }
+
+    /**
+     * Reads [count] values of [WIDTH] bits to [values], same as calling read for each of them <br>
+     * The width is known at compile time, so each 64 bits load gives (64 - 7) / WIDTH values
+     * (up to 7 bits of its first byte were already read) with unrolled shifts
+     */
+    template<uint32_t WIDTH>
+    void readRun(uint32_t* values, size_t count) {
+        static_assert(WIDTH > 0 && WIDTH <= 32, "Values are at most 32 bits");
+        const uint32_t VALUES_PER_LOAD = (64 - 7) / WIDTH;
+
+        size_t i = 0;
+        size_t lengthInBytes = lengthInBits / 8;
+        while (count - i >= VALUES_PER_LOAD && position / 8 + 8 <= lengthInBytes) {
+            uint64_t bits = loadBigEndian64(input + position / 8) << (position % 8);
+            for (uint32_t j = 0; j < VALUES_PER_LOAD; ++j)
+                values[i + j] = (uint32_t) ((bits << (j * WIDTH)) >> (64 - WIDTH));
+
+            i += VALUES_PER_LOAD;
+            position += VALUES_PER_LOAD * WIDTH;
+        }
+
+        // The last bytes, where 8 of them can not be loaded
+        for (; i < count; ++i)
+            values[i] = read(WIDTH);
+    }
+
+    size_t remaining() const {
+        return lengthInBits - position;
+    }
+
+private:
+
+    // Compilers turn it into a single load and byte swap
+    static uint64_t loadBigEndian64(const uint8_t* data) {
+        return (uint64_t) data[0] << 56 | (uint64_t) data[1] << 48 | (uint64_t) data[2] << 40 |
+               (uint64_t) data[3] << 32 | (uint64_t) data[4] << 24 | (uint64_t) data[5] << 16 |
+               (uint64_t) data[6] << 8 | (uint64_t) data[7];
+    }
+
+};
+
+#endif //BIT_IO_H
@@ -0,0 +1,137 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CPU_HAS_X86
+#define CPU_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+#define CPU_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define CPU_HAS_X86
+#define CPU_TARGET_SSE42
+#define CPU_TARGET_AVX2
+#define CPU_TARGET_AVX512
+#endif
+
+/**
+ * Instruction sets of the SIMD kernels, detected at runtime so the binary is built without architecture flags
+ * and still runs on any CPU <br>
+ * Each kernel has a scalar version and versions compiled for some of the levels (with the CPU_TARGET_ attributes),
+ * and runs the best one not above active(), which can be lowered to benchmark or test the other versions
+ */
+namespace CPU {
+
+    // Each level implies the ones before it, AVX512 is AVX-512 F and BW (the byte instructions)
+    enum class Level : uint8_t {
+        SCALAR, SSE42, AVX2, AVX512
+    };
+
+    const Level LEVELS[] = {Level::SCALAR, Level::SSE42, Level::AVX2, Level::AVX512};
+
+    inline const char* name(Level level) {
+        switch (level) {
+            case Level::SSE42:
+                return "sse4.2";
+            case Level::AVX2:
+                return "avx2";
+            case Level::AVX512:
+                return "avx512";
+            default:
+                return "scalar";
+        }
+    }
+
+    // Level of a name given by name(), returns false if it is unknown
+    inline bool parse(const std::string& text, Level& level) {
+        for (Level candidate : LEVELS) {
+            if (text == name(candidate)) {
+                level = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Best level supported by the CPU and enabled by the operating system (which saves the wide registers)
+    inline Level detect() {
+#if defined(CPU_HAS_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        bool hasSSE42 = (info[2] & (1 << 20)) != 0;
+        bool hasXSave = (info[2] & (1 << 27)) != 0;
+
+        uint64_t enabledStates = hasXSave ? _xgetbv(0) : 0;
+        __cpuidex(info, 7, 0);
+        bool hasAVX2 = (info[1] & (1 << 5)) != 0 && (enabledStates & 0x6) == 0x6;
+        bool hasAVX512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0 && (enabledStates & 0xE6) == 0xE6;
+#elif defined(CPU_HAS_X86)
+        __builtin_cpu_init();
+        bool hasSSE42 = __builtin_cpu_supports("sse4.2");
+        bool hasAVX2 = __builtin_cpu_supports("avx2");
+        bool hasAVX512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#else
+        bool hasSSE42 = false, hasAVX2 = false, hasAVX512 = false;
+#endif
+        if (hasAVX512 && hasAVX2 && hasSSE42)
+            return Level::AVX512;
+        if (hasAVX2 && hasSSE42)
+            return Level::AVX2;
+        return hasSSE42 ? Level::SSE42 : Level::SCALAR;
+    }
+
+    // Checked once, it does not change while running
+    inline Level detected() {
+        static const Level level = detect();
+        return level;
+    }
+
+    inline std::atomic<uint8_t>& activeLevel() {
+        static std::atomic<uint8_t> level((uint8_t) detected());
+        return level;
+    }
+
+    // Level the kernels run at, the detected one unless force() lowered it
+    inline Level active() {
+        return (Level) activeLevel().load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Runs the kernels at [level] instead of the detected one, for benchmarks and tests <br>
+     * Returns false (and keeps the active level) if the CPU does not support it
+     */
+    inline bool force(Level level) {
+        if (level > detected())
+            return false;
+
+        activeLevel().store((uint8_t) level, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Index of the lowest set bit of the comparison mask of a kernel, [mask] must not be 0
+    inline uint32_t lowestSetBit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return index;
+#else
+        uint32_t index = 0;
+        while ((mask & 1) == 0) {
+            mask >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+
+}
+
+#endif //CPU_H
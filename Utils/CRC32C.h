@@ -0,0 +1,107 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "CPU.h"
+
+/**
+ * CRC-32C (Castagnoli) checksum of the blocks <br>
+ * Computed with the crc32 instruction of SSE4.2 when the CPU has it (see CPU.h, so the binary still runs without it),
+ * otherwise with 8 lookup tables processing 8 bytes at a time
+ */
+namespace CRC32C {
+
+    // Reversed Castagnoli polynomial
+    const uint32_t POLYNOMIAL = 0x82F63B78;
+
+    struct Tables {
+        uint32_t values[8][256];
+
+        Tables() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ (POLYNOMIAL & (0 - (crc & 1)));
+                values[0][i] = crc;
+            }
+
+            // values[k][i] is the CRC of the byte i followed by k zero bytes
+            for (uint32_t i = 0; i < 256; ++i) {
+                for (int k = 1; k < 8; ++k)
+                    values[k][i] = (values[k - 1][i] >> 8) ^ values[0][values[k - 1][i] & 0xFF];
+            }
+        }
+
+        static const Tables& instance() {
+            static const Tables tables;
+            return tables;
+        }
+    };
+
+    // Works on the inverted CRC, as the instruction does
+    inline uint32_t updateWithTables(uint32_t crc, const uint8_t* data, size_t length) {
+        const Tables& tables = Tables::instance();
+
+        for (; length >= 8; data += 8, length -= 8) {
+            uint32_t low = (data[0] | data[1] << 8 | data[2] << 16 | (uint32_t) data[3] << 24) ^ crc;
+            uint32_t high = data[4] | data[5] << 8 | data[6] << 16 | (uint32_t) data[7] << 24;
+
+            crc = tables.values[7][low & 0xFF] ^ tables.values[6][(low >> 8) & 0xFF] ^
+                  tables.values[5][(low >> 16) & 0xFF] ^ tables.values[4][low >> 24] ^
+                  tables.values[3][high & 0xFF] ^ tables.values[2][(high >> 8) & 0xFF] ^
+                  tables.values[1][(high >> 16) & 0xFF] ^ tables.values[0][high >> 24];
+        }
+
+        for (; length > 0; ++data, --length)
+            crc = (crc >> 8) ^ tables.values[0][(crc ^ *data) & 0xFF];
+        return crc;
+    }
+
+#ifdef CPU_HAS_X86
+    CPU_TARGET_SSE42
+    inline uint32_t updateWithSSE42(uint32_t crc, const uint8_t* data, size_t length) {
+#if defined(__x86_64__) || defined(_M_X64)
+        uint64_t crc64 = crc;
+        for (; length >= 8; data += 8, length -= 8) {
+            uint64_t value;
+            memcpy(&value, data, 8);
+            crc64 = _mm_crc32_u64(crc64, value);
+        }
+        crc = (uint32_t) crc64;
+#endif
+        for (; length >= 4; data += 4, length -= 4) {
+            uint32_t value;
+            memcpy(&value, data, 4);
+            crc = _mm_crc32_u32(crc, value);
+        }
+        for (; length > 0; ++data, --length)
+            crc = _mm_crc32_u8(crc, *data);
+        return crc;
+    }
+#endif
+
+    // Unless the kernels are forced to the scalar level
+    inline bool isHardwareAccelerated() {
+        return CPU::active() >= CPU::Level::SSE42;
+    }
+
+    /**
+     * Extends the checksum [crc] of some data with the next [length] bytes, start with 0
+     */
+    inline uint32_t update(uint32_t crc, const uint8_t* data, size_t length) {
+#ifdef CPU_HAS_X86
+        if (isHardwareAccelerated())
+            return ~updateWithSSE42(~crc, data, length);
+#endif
+        return ~updateWithTables(~crc, data, length);
+    }
+
+    inline uint32_t compute(const uint8_t* data, size_t length) {
+        return update(0, data, length);
+    }
+
+}
+
+#endif //CRC32C_H
@@ -0,0 +1,81 @@
+#ifndef CONTEXT_POOL_H
+#define CONTEXT_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Pool of reusable codec contexts (Compressor::Context, BWT::Encoder, ...) for running many compressions concurrently <br>
+ * The lock is only held while taking or returning a context, the compressions themselves share nothing
+ */
+template<typename Context>
+class ContextPool {
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Context>> available;
+
+public:
+
+    /**
+     * A context taken from the pool, it is given back when the lease goes out of scope
+     */
+    class Lease {
+        ContextPool* pool;
+        std::unique_ptr<Context> context;
+
+    public:
+        Lease(ContextPool* pool, std::unique_ptr<Context> context) : pool(pool), context(std::move(context)) {}
+
+        Lease(Lease&& other) : pool(other.pool), context(std::move(other.context)) {}
+
+        ~Lease() {
+            if (context)
+                pool->giveBack(std::move(context));
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        Context& operator*() const {
+            return *context;
+        }
+
+        Context* operator->() const {
+            return context.get();
+        }
+    };
+
+    // Returns an idle context, or a new one if all of them are in use
+    Lease acquire() {
+        std::unique_ptr<Context> context;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!available.empty()) {
+                context = std::move(available.back());
+                available.pop_back();
+            }
+        }
+
+        if (!context)
+            context.reset(new Context);
+
+        return Lease(this, std::move(context));
+    }
+
+    // Number of idle contexts
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return available.size();
+    }
+
+private:
+
+    void giveBack(std::unique_ptr<Context> context) {
+        std::lock_guard<std::mutex> lock(mutex);
+        available.push_back(std::move(context));
+    }
+
+};
+
+#endif //CONTEXT_POOL_H
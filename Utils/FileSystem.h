@@ -0,0 +1,142 @@
+#ifndef FILE_SYSTEM_H
+#define FILE_SYSTEM_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Directories helpers for the archive mode, C++11 has no std::filesystem <br>
+ * Paths use '/' as separator, which Windows accepts as well
+ */
+namespace FileSystem {
+
+    inline bool isDirectory(const std::string& path) {
+#ifdef _WIN32
+        DWORD attributes = GetFileAttributesA(path.c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+        struct stat status;
+        return stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode);
+#endif
+    }
+
+    inline bool exists(const std::string& path) {
+#ifdef _WIN32
+        return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+#else
+        struct stat status;
+        return stat(path.c_str(), &status) == 0;
+#endif
+    }
+
+    /**
+     * Names of the entries of the directory [path] (without "." and ".."), sorted so archives are reproducible <br>
+     * Symbolic links are skipped, so a link to a parent directory can not loop forever <br>
+     * Returns false if the directory can not be opened
+     */
+    inline bool listDirectory(const std::string& path, std::vector<std::string>& names) {
+        names.clear();
+#ifdef _WIN32
+        WIN32_FIND_DATAA entry;
+        HANDLE handle = FindFirstFileA((path + "/*").c_str(), &entry);
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+
+        do {
+            std::string name = entry.cFileName;
+            if (name != "." && name != ".." && !(entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                names.push_back(name);
+        } while (FindNextFileA(handle, &entry));
+        FindClose(handle);
+#else
+        DIR* directory = opendir(path.c_str());
+        if (directory == nullptr)
+            return false;
+
+        while (dirent* entry = readdir(directory)) {
+            std::string name = entry->d_name;
+            struct stat status;
+            if (name != "." && name != ".." && lstat((path + "/" + name).c_str(), &status) == 0 &&
+                !S_ISLNK(status.st_mode))
+                names.push_back(name);
+        }
+        closedir(directory);
+#endif
+        std::sort(names.begin(), names.end());
+        return true;
+    }
+
+    // Creates [path] and its missing parents, returns false if one of them can not be created
+    inline bool createDirectories(const std::string& path) {
+        if (path.empty() || isDirectory(path))
+            return true;
+
+        size_t separator = path.find_last_of("/\\");
+        if (separator != std::string::npos && separator > 0 && !createDirectories(path.substr(0, separator)))
+            return false;
+
+#ifdef _WIN32
+        CreateDirectoryA(path.c_str(), nullptr);
+#else
+        mkdir(path.c_str(), 0777);
+#endif
+        return isDirectory(path);
+    }
+
+    // Last component of [path], ignoring trailing separators
+    inline std::string baseName(std::string path) {
+        while (path.size() > 1 && (path.back() == '/' || path.back() == '\\'))
+            path.pop_back();
+
+        size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? path : path.substr(separator + 1);
+    }
+
+    // Part of [path] before its last component, empty if there is none
+    inline std::string parentPath(const std::string& path) {
+        size_t separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? std::string() : path.substr(0, separator);
+    }
+
+    // [path] relative to the root instead of the working directory, unchanged if it can not be resolved
+    inline std::string absolutePath(const std::string& path) {
+#ifdef _WIN32
+        char absolute[MAX_PATH];
+        DWORD length = GetFullPathNameA(path.c_str(), MAX_PATH, absolute, nullptr);
+        return length > 0 && length < MAX_PATH ? std::string(absolute, length) : path;
+#else
+        if (!path.empty() && path[0] == '/')
+            return path;
+
+        std::vector<char> workingDirectory(4096);
+        if (getcwd(workingDirectory.data(), workingDirectory.size()) == nullptr)
+            return path;
+        return std::string(workingDirectory.data()) + "/" + path;
+#endif
+    }
+
+    // ID of the current process, so names of temporary files do not collide between processes
+    inline unsigned long processId() {
+#ifdef _WIN32
+        return GetCurrentProcessId();
+#else
+        return (unsigned long) getpid();
+#endif
+    }
+
+}
+
+#endif //FILE_SYSTEM_H
@@ -0,0 +1,208 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Bump allocator for the temporary buffers of the compression stages <br>
+ * Buffers are handed out linearly and released all at once, either by rewinding to a Scope
+ * or by reset() between blocks. After the first block the arena owns a single chunk large enough
+ * for the whole pipeline, so the buffers of the BWT, MTF, LZW and transforms are not allocated again <br>
+ * The Huffman coder still builds its tree, codes and bit_string buffers on the heap,
+ * as do the functions working on files and std::string
+ */
+class ScratchArena {
+
+    static const size_t ALIGNMENT = 64; // cache line, so buffers of different stages never share a line
+    static const size_t MINIMUM_CHUNK_SIZE = 1u << 20;
+
+    struct Chunk {
+        void* memory; // as returned by malloc
+        uint8_t* data; // aligned start
+        size_t capacity;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t currentChunk = 0;
+    size_t offset = 0;
+    size_t usedBytes = 0;
+    size_t peakUsedBytes = 0;
+
+public:
+
+    /**
+     * Position in the arena, everything allocated after it is released when rewinding to it
+     */
+    struct Marker {
+        size_t chunk;
+        size_t offset;
+        size_t usedBytes;
+    };
+
+    /**
+     * Rewinds the arena to where it was at construction when going out of scope <br>
+     * Allocations must be released in LIFO order, which matches the recursion of the stages
+     */
+    class Scope {
+        ScratchArena& arena;
+        Marker marker;
+
+    public:
+        explicit Scope(ScratchArena& arena) : arena(arena), marker(arena.mark()) {}
+
+        ~Scope() {
+            arena.rewind(marker);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    explicit ScratchArena(size_t initialCapacity = 0) {
+        if (initialCapacity > 0) {
+            addChunk(initialCapacity);
+        }
+    }
+
+    ~ScratchArena() {
+        release();
+    }
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    /**
+     * Arena shared by all stages running on the calling thread
+     */
+    static ScratchArena& forCurrentThread() {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+    /**
+     * Returns uninitialized storage for [count] elements of a trivial type
+     */
+    template<typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivial<T>::value, "ScratchArena only holds trivial types");
+        return static_cast<T*>(allocateBytes(count * sizeof(T)));
+    }
+
+    void* allocateBytes(size_t size) {
+        size = alignUp(size);
+
+        while (currentChunk < chunks.size() && chunks[currentChunk].capacity - offset < size) {
+            // Move to the next chunk, the tail of this one is wasted until the next rewind
+            currentChunk++;
+            offset = 0;
+        }
+
+        if (currentChunk == chunks.size()) {
+            size_t lastCapacity = chunks.empty() ? 0 : chunks.back().capacity;
+            addChunk(std::max(size, 2 * lastCapacity));
+            offset = 0;
+        }
+
+        void* pointer = chunks[currentChunk].data + offset;
+        offset += size;
+        usedBytes += size;
+        if (usedBytes > peakUsedBytes)
+            peakUsedBytes = usedBytes;
+
+        return pointer;
+    }
+
+    Marker mark() const {
+        return {currentChunk, offset, usedBytes};
+    }
+
+    void rewind(const Marker& marker) {
+        currentChunk = marker.chunk;
+        offset = marker.offset;
+        usedBytes = marker.usedBytes;
+    }
+
+    /**
+     * Releases all allocations <br>
+     * If the last block needed more than one chunk, they are merged into a single chunk
+     * big enough for the peak usage, so the next block of the same size does not touch the heap
+     */
+    void reset() {
+        if (chunks.size() > 1) {
+            size_t totalCapacity = 0;
+            for (const Chunk& chunk : chunks)
+                totalCapacity += chunk.capacity;
+
+            release();
+            addChunk(totalCapacity);
+        }
+
+        currentChunk = 0;
+        offset = 0;
+        usedBytes = 0;
+    }
+
+    /**
+     * Gives all memory back to the system
+     */
+    void release() {
+        for (const Chunk& chunk : chunks)
+            std::free(chunk.memory);
+
+        chunks.clear();
+        currentChunk = 0;
+        offset = 0;
+        usedBytes = 0;
+    }
+
+    size_t capacity() const {
+        size_t totalCapacity = 0;
+        for (const Chunk& chunk : chunks)
+            totalCapacity += chunk.capacity;
+        return totalCapacity;
+    }
+
+    // Bytes currently allocated
+    size_t usage() const {
+        return usedBytes;
+    }
+
+    // Highest usage since the creation of the arena or the last resetPeakUsage()
+    size_t peakUsage() const {
+        return peakUsedBytes;
+    }
+
+    void resetPeakUsage() {
+        peakUsedBytes = usedBytes;
+    }
+
+    void resetPeakUsage(size_t peakUsage) {
+        peakUsedBytes = std::max(peakUsage, usedBytes);
+    }
+
+private:
+
+    static size_t alignUp(size_t size) {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void addChunk(size_t capacity) {
+        capacity = std::max(alignUp(capacity), (size_t) MINIMUM_CHUNK_SIZE);
+
+        void* memory = std::malloc(capacity + ALIGNMENT);
+        if (memory == nullptr)
+            throw std::bad_alloc();
+
+        uint8_t* data = (uint8_t*) alignUp((uintptr_t) memory);
+        chunks.push_back({memory, data, capacity});
+    }
+
+};
+
+#endif //SCRATCH_ARENA_H
@@ -0,0 +1,237 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <sstream>
+#include <string>
+#include "ScratchArena.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+/**
+ * Instrumentation of the compression stages <br>
+ * Each run of a stage is reported as an Event to an optional callback, and summed per stage in a Recorder
+ */
+namespace Stats {
+
+    enum class Stage {
+        IO, SuffixArray, BWT, MTF, LZW, Huffman, LongRange, RLE, Checksum, ChunkCache, Sampling, FMIndex, WordTransform,
+        NumericTransform, COUNT
+    };
+
+    inline const char* stageName(Stage stage) {
+        static const char* const names[] = {"IO", "SuffixArray", "BWT", "MTF", "LZW", "Huffman", "LongRange", "RLE",
+                                            "Checksum", "ChunkCache", "Sampling", "FMIndex", "WordTransform",
+                                            "NumericTransform"};
+        return names[(int) stage];
+    }
+
+    struct Event {
+        Stage stage;
+        double wallSeconds;
+        double cpuSeconds;
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+        uint64_t peakMemory; // Scratch memory used by the stage
+    };
+
+    struct StageStats {
+        uint64_t calls = 0;
+        double wallSeconds = 0;
+        double cpuSeconds = 0;
+        uint64_t bytesIn = 0;
+        uint64_t bytesOut = 0;
+        uint64_t peakMemory = 0;
+
+        // Megabytes of input per second
+        double throughput() const {
+            return wallSeconds > 0 ? bytesIn / wallSeconds / 1e6 : 0;
+        }
+    };
+
+    // CPU time of the calling thread, so concurrent compressions do not count each other
+    inline double threadCpuSeconds() {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+        uint64_t kernelTime = ((uint64_t) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+        uint64_t userTime = ((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime;
+        return (kernelTime + userTime) * 1e-7; // 100 nanoseconds units
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return time.tv_sec + time.tv_nsec * 1e-9;
+#else
+        return (double) std::clock() / CLOCKS_PER_SEC;
+#endif
+    }
+
+    // Peak resident memory of the whole process in bytes
+    inline uint64_t peakResidentMemory() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss; // bytes
+#else
+        return (uint64_t) usage.ru_maxrss * 1024; // kilobytes
+#endif
+#endif
+    }
+
+    /**
+     * Sums the events of each stage and forwards them to [callback] if it is set <br>
+     * A recorder must only be used by one thread at a time, as the context it is attached to
+     */
+    class Recorder {
+
+        StageStats stages[(int) Stage::COUNT];
+
+    public:
+
+        std::function<void(const Event&)> callback;
+
+        Recorder() = default;
+
+        explicit Recorder(std::function<void(const Event&)> callback) : callback(std::move(callback)) {}
+
+        void record(const Event& event) {
+            StageStats& stats = stages[(int) event.stage];
+            stats.calls++;
+            stats.wallSeconds += event.wallSeconds;
+            stats.cpuSeconds += event.cpuSeconds;
+            stats.bytesIn += event.bytesIn;
+            stats.bytesOut += event.bytesOut;
+            if (event.peakMemory > stats.peakMemory)
+                stats.peakMemory = event.peakMemory;
+
+            if (callback)
+                callback(event);
+        }
+
+        const StageStats& operator[](Stage stage) const {
+            return stages[(int) stage];
+        }
+
+        std::string toJson() const {
+            std::ostringstream json;
+            json << "{\n  \"stages\": [";
+
+            bool isFirst = true;
+            for (int i = 0; i < (int) Stage::COUNT; ++i) {
+                const StageStats& stats = stages[i];
+                if (stats.calls == 0)
+                    continue;
+
+                json << (isFirst ? "\n" : ",\n");
+                json << "    {\"stage\": \"" << stageName((Stage) i) << "\""
+                     << ", \"calls\": " << stats.calls
+                     << ", \"wall_seconds\": " << stats.wallSeconds
+                     << ", \"cpu_seconds\": " << stats.cpuSeconds
+                     << ", \"bytes_in\": " << stats.bytesIn
+                     << ", \"bytes_out\": " << stats.bytesOut
+                     << ", \"throughput_mb_per_second\": " << stats.throughput()
+                     << ", \"peak_memory_bytes\": " << stats.peakMemory << "}";
+                isFirst = false;
+            }
+
+            json << "\n  ],\n  \"peak_resident_memory_bytes\": " << peakResidentMemory() << "\n}\n";
+            return json.str();
+        }
+
+        std::string toText() const {
+            std::ostringstream text;
+            text.precision(3);
+            text << std::fixed;
+            for (int i = 0; i < (int) Stage::COUNT; ++i) {
+                const StageStats& stats = stages[i];
+                if (stats.calls == 0)
+                    continue;
+
+                text << stageName((Stage) i) << ": " << stats.wallSeconds << "s wall, " << stats.cpuSeconds << "s cpu, "
+                     << stats.bytesIn << " -> " << stats.bytesOut << " bytes, " << stats.throughput() << " MB/s, "
+                     << stats.peakMemory << " bytes peak scratch memory\n";
+            }
+            text << "Peak resident memory: " << peakResidentMemory() << " bytes\n";
+            return text.str();
+        }
+    };
+
+    /**
+     * Measures one run of a stage from construction to destruction, does nothing without a recorder <br>
+     * Measures can be nested (SuffixArray inside BWT), the scratch peak of the outer one includes the inner one
+     */
+    class Measure {
+
+        Recorder* recorder;
+        ScratchArena* arena;
+        Event event;
+        double otherThreadsCpuSeconds = 0;
+        std::chrono::steady_clock::time_point wallStart;
+        size_t arenaStartUsage = 0;
+        size_t outerPeakUsage = 0;
+
+    public:
+
+        Measure(Recorder* recorder, Stage stage, uint64_t bytesIn, ScratchArena* arena = nullptr)
+                : recorder(recorder), arena(arena) {
+            if (recorder == nullptr)
+                return;
+
+            event = {stage, 0, 0, bytesIn, 0, 0};
+            if (arena != nullptr) {
+                arenaStartUsage = arena->usage();
+                outerPeakUsage = arena->peakUsage();
+                arena->resetPeakUsage();
+            }
+            event.cpuSeconds = threadCpuSeconds();
+            wallStart = std::chrono::steady_clock::now();
+        }
+
+        void setBytesOut(uint64_t bytesOut) {
+            event.bytesOut = bytesOut;
+        }
+
+        // CPU time the stage spent in the threads it started, which the calling thread does not see
+        void addCpuSeconds(double seconds) {
+            otherThreadsCpuSeconds += seconds;
+        }
+
+        ~Measure() {
+            if (recorder == nullptr)
+                return;
+
+            event.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+            event.cpuSeconds = threadCpuSeconds() - event.cpuSeconds + otherThreadsCpuSeconds;
+            if (arena != nullptr) {
+                event.peakMemory = arena->peakUsage() - arenaStartUsage;
+                arena->resetPeakUsage(std::max(outerPeakUsage, arena->peakUsage()));
+            }
+            recorder->record(event);
+        }
+
+        Measure(const Measure&) = delete;
+        Measure& operator=(const Measure&) = delete;
+    };
+
+}
+
+#endif //STATS_H
@@ -0,0 +1,100 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed number of worker threads running submitted tasks in order of submission <br>
+ * Workers live as long as the pool, so their thread local contexts (Compressor::Context::forCurrentThread())
+ * are reused by all the tasks they run
+ */
+class ThreadPool {
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable hasTasks;
+    bool isStopping = false;
+
+public:
+
+    explicit ThreadPool(size_t numberOfThreads = defaultNumberOfThreads()) {
+        if (numberOfThreads == 0)
+            numberOfThreads = 1;
+
+        for (size_t i = 0; i < numberOfThreads; ++i)
+            workers.emplace_back([this]() { run(); });
+    }
+
+    // Waits for the tasks already submitted
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            isStopping = true;
+        }
+        hasTasks.notify_all();
+
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Queues [task], the returned future gives its result (or rethrows its exception) once it has run
+     */
+    template<typename Task>
+    std::future<typename std::result_of<Task()>::type> submit(Task task) {
+        typedef typename std::result_of<Task()>::type Result;
+
+        // std::function needs a copyable callable, which packaged_task is not
+        auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        std::future<Result> result = packagedTask->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([packagedTask]() { (*packagedTask)(); });
+        }
+        hasTasks.notify_one();
+
+        return result;
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    static size_t defaultNumberOfThreads() {
+        size_t numberOfThreads = std::thread::hardware_concurrency();
+        return numberOfThreads > 0 ? numberOfThreads : 1; // 0 if it can not be detected
+    }
+
+private:
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                hasTasks.wait(lock, [this]() { return isStopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+};
+
+#endif //THREAD_POOL_H
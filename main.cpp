@@ -1,58 +1,453 @@
 #include <iostream>
+#include "Compressors/Archive.h"
 #include "Compressors/Compressor.h"
+#include "Compressors/Daemon.h"
 
-void compressWithOutputInfo(const std::string& toBeCompressedFilename, const std::string& outputFilename);
+struct CommandLineOptions {
+    Compressor::Options compressorOptions;
+    bool hasRange = false;
+    uint64_t rangeOffset = 0;
+    uint64_t rangeLength = 0;
+    std::string statsFormat; // empty when no stats are printed
+    size_t numberOfThreads = ThreadPool::defaultNumberOfThreads();
+    std::string dictionaryFilename; // empty when no dictionary is used
+    uint64_t dictionarySize = Dictionary::DEFAULT_SIZE;
+    std::string chunkCacheDirectory; // empty when no chunk cache is used
+    std::string daemonSocket; // empty when the files are compressed by this process
+    bool isNumericFilterNone = false; // --numeric none, which also removes the filter of a daemon
+    uint64_t contextSize = 32; // bytes printed before and after each match of a search
+    bool isCPULevelForced = false;
+    CPU::Level cpuLevel = CPU::detected(); // of the SIMD kernels
+};
 
-void decompressWithOutputInfo(const std::string& toBeDecompressedFilename, const std::string& outputFilename);
+void compressWithOutputInfo(const std::string& toBeCompressedFilename, const std::string& outputFilename,
+                            const CommandLineOptions& options);
+
+void decompressWithOutputInfo(const std::string& toBeDecompressedFilename, const std::string& outputFilename,
+                              const CommandLineOptions& options);
+
+void archiveWithOutputInfo(const std::string& archiveFilename, const std::vector<std::string>& inputs,
+                           const CommandLineOptions& options);
+
+void extractWithOutputInfo(const std::string& archiveFilename, const std::string& outputDirectory,
+                           const CommandLineOptions& options);
+
+void listWithOutputInfo(const std::string& archiveFilename);
+
+void testWithOutputInfo(const std::string& compressedFilename, const CommandLineOptions& options);
+
+void searchWithOutputInfo(const std::string& compressedFilename, const std::string& pattern,
+                          const CommandLineOptions& options);
+
+void trainWithOutputInfo(const std::string& dictionaryFilename, const std::vector<std::string>& samples,
+                         const CommandLineOptions& options);
+
+void runDaemon(const std::string& socketPath, const CommandLineOptions& options);
+
+bool callDaemon(const std::string& socketPath, uint8_t kind, const std::string& inputFilename,
+                const std::string& outputFilename, const CommandLineOptions& options, std::string& reply);
+
+void loadDictionaryOrExit(const std::string& dictionaryFilename, Dictionary& dictionary);
+
+void forceCPULevelOrExit(CPU::Level level);
 
 void checkFilesAndExitIfFoundErrors(const std::string& inputFilename, const std::string& outputFilename);
 
+bool parseOptions(int argc, char** argv, int firstOption, CommandLineOptions& options);
+
+bool parseSize(const std::string& text, uint64_t& size);
+
+void printStats(const Stats::Recorder& recorder, const std::string& format);
+
 void showHelp();
 
 int main(int argc, char** argv) {
 
-    if (argc == 4) {
-        std::string mode = argv[1];
+    std::string mode = argc >= 2 ? argv[1] : "";
+    if (mode == "-l" || mode == "--list") {
+        if (argc == 3)
+            listWithOutputInfo(argv[2]);
+        else
+            showHelp();
+        return 0;
+    }
+
+    if (mode == "--daemon-metrics" || mode == "--daemon-stop") {
+        std::string reply;
+        uint8_t kind = mode == "--daemon-metrics" ? Daemon::METRICS : Daemon::STOP;
+        if (argc != 3)
+            showHelp();
+        else if (!callDaemon(argv[2], kind, "", "", CommandLineOptions(), reply))
+            exit(1);
+        std::cout << reply;
+        return 0;
+    }
+
+    // The inputs of an archive (or the samples of a dictionary) go until the first flag
+    int firstOption = mode == "-T" || mode == "--test" || mode == "-D" || mode == "--daemon" ? 3 : 4;
+    std::vector<std::string> inputs;
+    if (mode == "-a" || mode == "--archive" || mode == "-t" || mode == "--train") {
+        for (firstOption = 3; firstOption < argc && std::string(argv[firstOption]).compare(0, 2, "--") != 0; ++firstOption)
+            inputs.push_back(argv[firstOption]);
+    }
+
+    CommandLineOptions options;
+    if (argc >= firstOption && parseOptions(argc, argv, firstOption, options)) {
+        Stats::Recorder recorder;
+        if (!options.statsFormat.empty())
+            Compressor::Context::forCurrentThread().stats = &recorder;
+        Compressor::Context::forCurrentThread().setNumberOfThreads(options.numberOfThreads);
+        if (options.isCPULevelForced)
+            forceCPULevelOrExit(options.cpuLevel);
+
+        Dictionary dictionary;
+        if (!options.dictionaryFilename.empty()) {
+            loadDictionaryOrExit(options.dictionaryFilename, dictionary);
+            options.compressorOptions.dictionary = &dictionary;
+            Compressor::Context::forCurrentThread().dictionary = &dictionary;
+        }
+
         if (mode == "-c" || mode == "--compress") {
             std::string toBeCompressedFilename = argv[2];
             std::string outputFilename = argv[3];
-            compressWithOutputInfo(toBeCompressedFilename, outputFilename);
+            compressWithOutputInfo(toBeCompressedFilename, outputFilename, options);
         } else if (mode == "-d" || mode == "--decompress") {
             std::string toBeDecompressedFilename = argv[2];
             std::string outputFilename = argv[3];
-            decompressWithOutputInfo(toBeDecompressedFilename, outputFilename);
+            decompressWithOutputInfo(toBeDecompressedFilename, outputFilename, options);
+        } else if ((mode == "-a" || mode == "--archive") && !inputs.empty()) {
+            std::string archiveFilename = argv[2];
+            archiveWithOutputInfo(archiveFilename, inputs, options);
+        } else if (mode == "-x" || mode == "--extract") {
+            std::string archiveFilename = argv[2];
+            std::string outputDirectory = argv[3];
+            extractWithOutputInfo(archiveFilename, outputDirectory, options);
+        } else if (mode == "-T" || mode == "--test") {
+            std::string compressedFilename = argv[2];
+            testWithOutputInfo(compressedFilename, options);
+        } else if (mode == "-s" || mode == "--search") {
+            std::string compressedFilename = argv[2];
+            std::string pattern = argv[3];
+            searchWithOutputInfo(compressedFilename, pattern, options);
+        } else if ((mode == "-t" || mode == "--train") && !inputs.empty()) {
+            std::string dictionaryFilename = argv[2];
+            trainWithOutputInfo(dictionaryFilename, inputs, options);
+        } else if (mode == "-D" || mode == "--daemon") {
+            std::string socketPath = argv[2];
+            runDaemon(socketPath, options);
         } else {
             showHelp();
         }
+
+        Compressor::Context::forCurrentThread().stats = nullptr;
+        Compressor::Context::forCurrentThread().dictionary = nullptr;
+        if (!options.statsFormat.empty())
+            printStats(recorder, options.statsFormat);
     } else {
         showHelp();
     }
     return 0;
 }
 
-void decompressWithOutputInfo(const std::string& toBeDecompressedFilename, const std::string& outputFilename) {
+void decompressWithOutputInfo(const std::string& toBeDecompressedFilename, const std::string& outputFilename,
+                              const CommandLineOptions& options) {
 
     checkFilesAndExitIfFoundErrors(toBeDecompressedFilename, outputFilename);
 
     std::cout << "Decompressing...\n";
-    Compressor::decompress(toBeDecompressedFilename, outputFilename);
+    if (!options.daemonSocket.empty()) {
+        std::string reply;
+        if (!callDaemon(options.daemonSocket, Daemon::DECOMPRESS_FILE, toBeDecompressedFilename, outputFilename,
+                        options, reply)) {
+            std::cerr << toBeDecompressedFilename << " is corrupted or needs another --dictionary!\n";
+            exit(1);
+        }
+        std::cout << "Finished Decompressing\n";
+        return;
+    }
+
+    bool isDecompressed = options.hasRange ? Compressor::decompressRange(toBeDecompressedFilename, outputFilename,
+                                                                         options.rangeOffset, options.rangeLength)
+                                           : Compressor::decompress(toBeDecompressedFilename, outputFilename);
+    if (!isDecompressed) {
+        std::cerr << toBeDecompressedFilename << " is corrupted or needs another --dictionary!\n";
+        exit(1);
+    }
     std::cout << "Finished Decompressing\n";
 }
 
 
-void compressWithOutputInfo(const std::string& toBeCompressedFilename, const std::string& outputFilename) {
+void compressWithOutputInfo(const std::string& toBeCompressedFilename, const std::string& outputFilename,
+                            const CommandLineOptions& options) {
 
     checkFilesAndExitIfFoundErrors(toBeCompressedFilename, outputFilename);
 
+    Compressor::Options compressorOptions = options.compressorOptions;
+    ChunkCache chunkCache(options.chunkCacheDirectory);
+    bool usesChunkCache = !options.chunkCacheDirectory.empty() && options.daemonSocket.empty(); // not by the daemon
+    if (usesChunkCache) {
+        if (!chunkCache.open()) {
+            std::cerr << "Chunk cache " << options.chunkCacheDirectory << " can not be created!\n";
+            exit(1);
+        }
+        compressorOptions.chunkCache = &chunkCache;
+    }
+
     std::cout << "Compressing...\n";
-    Compressor::compress(toBeCompressedFilename, outputFilename);
+    std::string reply;
+    bool isCompressed = options.daemonSocket.empty()
+                        ? Compressor::compress(toBeCompressedFilename, outputFilename, compressorOptions)
+                        : callDaemon(options.daemonSocket, Daemon::COMPRESS_FILE, toBeCompressedFilename, outputFilename,
+                                     options, reply);
+    if (!isCompressed) {
+        std::cerr << toBeCompressedFilename << " is too large to be compressed!\n";
+        exit(1);
+    }
     std::cout << "Finished Compressing\n";
 
-    int originalFileSize = BinaryIO::getFileSize(toBeCompressedFilename);
-    int compressedFileSize = BinaryIO::getFileSize(outputFilename);
+    if (usesChunkCache) {
+        std::cout << "Reused " << chunkCache.hits << " of " << chunkCache.hits + chunkCache.misses
+                  << " Blocks from the Chunk Cache\n";
+    }
+
+    int64_t originalFileSize = BinaryIO::getFileSize(toBeCompressedFilename);
+    int64_t compressedFileSize = BinaryIO::getFileSize(outputFilename);
     std::cout << "Compression Ratio: " << 1.0 * originalFileSize / compressedFileSize << std::endl;
 }
 
+void archiveWithOutputInfo(const std::string& archiveFilename, const std::vector<std::string>& inputs,
+                           const CommandLineOptions& options) {
+
+    for (const std::string& input : inputs) {
+        if (!FileSystem::exists(input)) {
+            std::cerr << "File " << input << " is not found!\n";
+            exit(0);
+        }
+    }
+    checkFilesAndExitIfFoundErrors(inputs.front(), archiveFilename);
+
+    std::cout << "Archiving...\n";
+    if (!Archive::create(archiveFilename, inputs, options.compressorOptions, options.numberOfThreads)) {
+        std::cerr << "Could not archive the inputs, a file can not be read or two files have the same path!\n";
+        exit(1);
+    }
+    std::cout << "Finished Archiving\n";
+
+    std::vector<Archive::Entry> entries;
+    Archive::list(archiveFilename, entries);
+    uint64_t originalSize = entries.empty() ? 0 : entries.back().offset + entries.back().size;
+    size_t numberOfFiles = 0;
+    for (const Archive::Entry& entry : entries)
+        numberOfFiles += entry.isDirectory ? 0 : 1;
+    int64_t compressedFileSize = BinaryIO::getFileSize(archiveFilename);
+    std::cout << numberOfFiles << " Files, Compression Ratio: " << 1.0 * originalSize / compressedFileSize << std::endl;
+}
+
+void extractWithOutputInfo(const std::string& archiveFilename, const std::string& outputDirectory,
+                           const CommandLineOptions& options) {
+
+    if (!BinaryIO::doesFileExist(archiveFilename)) {
+        std::cerr << "File " << archiveFilename << " is not found!\n";
+        exit(0);
+    }
+
+    std::cout << "Extracting...\n";
+    if (!Archive::extract(archiveFilename, outputDirectory, options.numberOfThreads)) {
+        std::cerr << archiveFilename << " is corrupted or " << outputDirectory << " can not be written!\n";
+        exit(1);
+    }
+    std::cout << "Finished Extracting\n";
+}
+
+void listWithOutputInfo(const std::string& archiveFilename) {
+    std::vector<Archive::Entry> entries;
+    if (!Archive::list(archiveFilename, entries)) {
+        std::cerr << archiveFilename << " is not an archive or is corrupted!\n";
+        exit(1);
+    }
+
+    for (const Archive::Entry& entry : entries)
+        std::cout << entry.size << "\t" << entry.path << (entry.isDirectory ? "/" : "") << "\n";
+}
+
+void testWithOutputInfo(const std::string& compressedFilename, const CommandLineOptions& options) {
+    if (!BinaryIO::doesFileExist(compressedFilename)) {
+        std::cerr << "File " << compressedFilename << " is not found!\n";
+        exit(0);
+    }
+
+    std::ifstream input(compressedFilename, std::ios::in | std::ios::binary);
+    uint8_t magic[sizeof(Archive::MAGIC)];
+    bool isArchive = BinaryIO::read(input, 0, magic, sizeof(magic)) && Archive::hasMagic(magic, sizeof(magic));
+
+    std::cout << "Testing...\n";
+    bool isValid = isArchive ? Archive::test(compressedFilename, options.numberOfThreads)
+                             : Compressor::test(compressedFilename);
+
+    if (!isValid) {
+        std::cerr << compressedFilename << " is corrupted, needs another --dictionary or has no checksums!\n";
+        exit(1);
+    }
+    std::cout << compressedFilename << " is OK\n";
+}
+
+// Prints each match as its offset (and its file for an archive) then its context, with the bytes which are not
+// printable as '.' so a match is always on a single line
+void searchWithOutputInfo(const std::string& compressedFilename, const std::string& pattern,
+                          const CommandLineOptions& options) {
+    if (!BinaryIO::doesFileExist(compressedFilename)) {
+        std::cerr << "File " << compressedFilename << " is not found!\n";
+        exit(0);
+    }
+
+    if (pattern.empty() || pattern.size() > Compressor::MAXIMUM_PATTERN_SIZE) {
+        std::cerr << "The pattern must have between 1 and " << Compressor::MAXIMUM_PATTERN_SIZE << " Bytes!\n";
+        exit(1);
+    }
+
+    std::ifstream input(compressedFilename, std::ios::in | std::ios::binary);
+    uint8_t magic[sizeof(Archive::MAGIC)];
+    bool isArchive = BinaryIO::read(input, 0, magic, sizeof(magic)) && Archive::hasMagic(magic, sizeof(magic));
+
+    auto printable = [](std::string text) {
+        for (char& c : text) {
+            if (c < ' ' || c > '~')
+                c = '.';
+        }
+        return text;
+    };
+
+    size_t numberOfMatches;
+    bool isValid;
+    if (isArchive) {
+        std::vector<Archive::Match> matches;
+        isValid = Archive::search(compressedFilename, pattern, options.contextSize, matches);
+        for (const Archive::Match& match : matches)
+            std::cout << match.path << ":" << match.offset << ":" << printable(match.context) << "\n";
+        numberOfMatches = matches.size();
+    } else {
+        std::vector<Compressor::Match> matches;
+        isValid = Compressor::search(compressedFilename, pattern, options.contextSize, matches);
+        for (const Compressor::Match& match : matches)
+            std::cout << match.offset << ":" << printable(match.context) << "\n";
+        numberOfMatches = matches.size();
+    }
+
+    if (!isValid) {
+        std::cerr << compressedFilename << " is corrupted or needs another --dictionary!\n";
+        exit(1);
+    }
+    std::cout << numberOfMatches << " Matches\n";
+}
+
+void trainWithOutputInfo(const std::string& dictionaryFilename, const std::vector<std::string>& samples,
+                         const CommandLineOptions& options) {
+
+    // Directories of samples are walked as for an archive
+    std::vector<Archive::Entry> entries;
+    if (!Archive::collectEntries(samples, entries)) {
+        std::cerr << "Could not read the samples, a file can not be read or two files have the same path!\n";
+        exit(1);
+    }
+    checkFilesAndExitIfFoundErrors(samples.front(), dictionaryFilename);
+
+    std::cout << "Training...\n";
+    std::vector<std::vector<uint8_t>> contents;
+    for (const Archive::Entry& entry : entries) {
+        if (entry.isDirectory)
+            continue;
+
+        std::ifstream input(entry.source, std::ios::in | std::ios::binary);
+        std::vector<uint8_t> content(std::min(entry.size, options.dictionarySize));
+        if (!BinaryIO::read(input, 0, content.data(), content.size())) {
+            std::cerr << "File " << entry.source << " can not be read!\n";
+            exit(1);
+        }
+        contents.push_back(std::move(content));
+    }
+
+    Dictionary dictionary = Compressor::trainDictionary(contents, options.dictionarySize);
+    if (!dictionary.save(dictionaryFilename)) {
+        std::cerr << dictionaryFilename << " can not be written!\n";
+        exit(1);
+    }
+    std::cout << "Finished Training\n";
+    std::cout << contents.size() << " Samples, Dictionary ID: " << dictionary.id() << ", Size: "
+              << dictionary.content().size() << std::endl;
+}
+
+void runDaemon(const std::string& socketPath, const CommandLineOptions& options) {
+#ifdef _WIN32
+    std::cerr << "The daemon needs Unix domain sockets, it is not available on Windows!\n";
+    exit(1);
+#else
+    Daemon::Server server(socketPath, options.compressorOptions, options.numberOfThreads);
+    if (!server.listen()) {
+        std::cerr << "Could not listen on " << socketPath << ", it can not be created or another daemon uses it!\n";
+        exit(1);
+    }
+
+    server.warmUp();
+    std::cout << "Listening on " << socketPath << " with " << options.numberOfThreads << " Threads\n" << std::flush;
+    server.run();
+    std::cout << "Stopped\n";
+#endif
+}
+
+// Sends a request to the daemon of [socketPath], with the files given as absolute paths
+bool callDaemon(const std::string& socketPath, uint8_t kind, const std::string& inputFilename,
+                const std::string& outputFilename, const CommandLineOptions& options, std::string& reply) {
+#ifdef _WIN32
+    std::cerr << "The daemon needs Unix domain sockets, it is not available on Windows!\n";
+    return false;
+#else
+    Daemon::Client client;
+    if (!client.connect(socketPath)) {
+        std::cerr << "No daemon listens on " << socketPath << "!\n";
+        return false;
+    }
+
+    Daemon::Request request;
+    request.kind = kind;
+    if (kind == Daemon::COMPRESS_FILE || kind == Daemon::DECOMPRESS_FILE) {
+        request.flags = (options.compressorOptions.longRange ? Daemon::FLAG_LONG_RANGE : 0) |
+                        (options.compressorOptions.runLength ? Daemon::FLAG_RLE : 0) |
+                        (options.compressorOptions.adaptive ? Daemon::FLAG_ADAPTIVE : 0) |
+                        (options.compressorOptions.searchIndex ? Daemon::FLAG_SEARCH_INDEX : 0) |
+                        (options.compressorOptions.wordTransform ? Daemon::FLAG_WORDS : 0) |
+                        (options.isNumericFilterNone ? Daemon::FLAG_NO_NUMERIC : 0);
+        request.blockSize = options.compressorOptions.blockSize != Format::DEFAULT_BLOCK_SIZE
+                            ? options.compressorOptions.blockSize : 0;
+        request.numericFilter = options.compressorOptions.numericFilter;
+        request.payload = Daemon::filePayload(FileSystem::absolutePath(inputFilename),
+                                              FileSystem::absolutePath(outputFilename));
+    }
+
+    Daemon::Response response;
+    if (!client.call(request, response)) {
+        std::cerr << "The daemon on " << socketPath << " closed the connection!\n";
+        return false;
+    }
+    reply.assign(response.payload.begin(), response.payload.end());
+    return response.status == Daemon::OK;
+#endif
+}
+
+void loadDictionaryOrExit(const std::string& dictionaryFilename, Dictionary& dictionary) {
+    if (!Dictionary::load(dictionaryFilename, dictionary)) {
+        std::cerr << dictionaryFilename << " is not a dictionary or is corrupted!\n";
+        exit(1);
+    }
+}
+
+void forceCPULevelOrExit(CPU::Level level) {
+    if (!CPU::force(level)) {
+        std::cerr << "The CPU does not support " << CPU::name(level) << ", its best level is "
+                  << CPU::name(CPU::detected()) << "!\n";
+        exit(1);
+    }
+}
+
 void checkFilesAndExitIfFoundErrors(const std::string& inputFilename, const std::string& outputFilename) {
     if (!BinaryIO::doesFileExist(inputFilename)) {
         std::cerr << "File " << inputFilename << " is not found!\n";
@@ -69,14 +464,157 @@ void checkFilesAndExitIfFoundErrors(const std::string& inputFilename, const std:
     }
 }
 
+bool parseOptions(int argc, char** argv, int firstOption, CommandLineOptions& options) {
+    for (int i = firstOption; i < argc; ++i) {
+        std::string option = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (option == "--range" && hasValue) {
+            // offset:length
+            std::string range = argv[++i];
+            size_t separator = range.find(':');
+            if (separator == std::string::npos)
+                return false;
+            if (!parseSize(range.substr(0, separator), options.rangeOffset) ||
+                !parseSize(range.substr(separator + 1), options.rangeLength))
+                return false;
+            options.hasRange = true;
+        } else if (option == "--block-size" && hasValue) {
+            uint64_t blockSize;
+            if (!parseSize(argv[++i], blockSize) || blockSize < Format::MINIMUM_BLOCK_SIZE ||
+                blockSize > Format::MAXIMUM_BLOCK_SIZE)
+                return false;
+            options.compressorOptions.blockSize = blockSize;
+        } else if (option == "--long-range") {
+            options.compressorOptions.longRange = true;
+        } else if (option == "--rle") {
+            options.compressorOptions.runLength = true;
+        } else if (option == "--words") {
+            options.compressorOptions.wordTransform = true;
+        } else if (option == "--numeric" && hasValue) {
+            if (!NumericTransform::parse(argv[++i], options.compressorOptions.numericFilter))
+                return false;
+            options.isNumericFilterNone =
+                    options.compressorOptions.numericFilter.operation == NumericTransform::Operation::NONE;
+        } else if (option == "--adaptive") {
+            options.compressorOptions.adaptive = true;
+        } else if (option == "--min-speed" && hasValue) {
+            uint64_t minimumSpeed;
+            if (!parseSize(argv[++i], minimumSpeed) || minimumSpeed == 0 || minimumSpeed > UINT32_MAX)
+                return false;
+            options.compressorOptions.adaptive = true;
+            options.compressorOptions.minimumSpeed = minimumSpeed;
+        } else if (option == "--index") {
+            options.compressorOptions.searchIndex = true;
+        } else if (option == "--context" && hasValue) {
+            if (!parseSize(argv[++i], options.contextSize) || options.contextSize > Format::MINIMUM_BLOCK_SIZE)
+                return false;
+        } else if (option == "--threads" && hasValue) {
+            uint64_t numberOfThreads;
+            if (!parseSize(argv[++i], numberOfThreads) || numberOfThreads == 0 || numberOfThreads > 1024)
+                return false;
+            options.numberOfThreads = numberOfThreads;
+        } else if (option == "--cpu" && hasValue) {
+            if (!CPU::parse(argv[++i], options.cpuLevel))
+                return false;
+            options.isCPULevelForced = true;
+        } else if (option == "--chunk-cache" && hasValue) {
+            options.chunkCacheDirectory = argv[++i];
+        } else if (option == "--via" && hasValue) {
+            options.daemonSocket = argv[++i];
+        } else if (option == "--dictionary" && hasValue) {
+            options.dictionaryFilename = argv[++i];
+        } else if (option == "--dictionary-size" && hasValue) {
+            if (!parseSize(argv[++i], options.dictionarySize) || options.dictionarySize == 0 ||
+                options.dictionarySize > Dictionary::MAXIMUM_SIZE)
+                return false;
+        } else if (option == "--stats" && hasValue) {
+            options.statsFormat = argv[++i];
+            if (options.statsFormat != "json" && options.statsFormat != "text")
+                return false;
+        } else {
+            return false;
+        }
+    }
+
+    // The blocks of the long range matching do not hold the original bytes, and a transformed block is not indexed
+    const Compressor::Options& compressorOptions = options.compressorOptions;
+    return !compressorOptions.searchIndex ||
+           (!compressorOptions.longRange && !compressorOptions.runLength && !compressorOptions.wordTransform &&
+            compressorOptions.numericFilter.operation == NumericTransform::Operation::NONE);
+}
+
+// Number of bytes with an optional K, M or G suffix
+bool parseSize(const std::string& text, uint64_t& size) {
+    size_t end = 0;
+    try {
+        size = std::stoull(text, &end);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    std::string suffix = text.substr(end);
+    if (suffix == "K" || suffix == "k")
+        size <<= 10;
+    else if (suffix == "M" || suffix == "m")
+        size <<= 20;
+    else if (suffix == "G" || suffix == "g")
+        size <<= 30;
+    else if (!suffix.empty())
+        return false;
+
+    return true;
+}
+
+// Stats go to the standard error, so they can be parsed apart from the progress messages
+void printStats(const Stats::Recorder& recorder, const std::string& format) {
+    std::cerr << (format == "json" ? recorder.toJson() : recorder.toText());
+}
+
 
 void showHelp() {
     std::cout << "Welcome to Compressor!\n"
                  "________________________________________________\n"
-                 "Usage : compressor OPTION input_file output_file\n\n"
+                 "Usage : compressor OPTION input_file output_file [FLAGS]\n"
+                 "        compressor -a archive_file input... [FLAGS]\n"
+                 "        compressor -x archive_file output_directory [FLAGS]\n"
+                 "        compressor -l archive_file\n"
+                 "        compressor -t dictionary_file sample... [FLAGS]\n"
+                 "        compressor -T compressed_file [FLAGS]\n"
+                 "        compressor -s compressed_file pattern [FLAGS]\n"
+                 "        compressor -D socket_file [FLAGS]\n"
+                 "        compressor --daemon-metrics|--daemon-stop socket_file\n\n"
 
                  "OPTION:\n"
                  "        -c  --compress     Compress the file\n"
-                 "        -d  --decompress   Decompress the file\n\n";
+                 "        -d  --decompress   Decompress the file\n"
+                 "        -a  --archive      Compress many files and directories into one archive\n"
+                 "        -x  --extract      Extract all the files of an archive to a directory\n"
+                 "        -l  --list         List the files of an archive and their sizes\n"
+                 "        -t  --train        Train a dictionary on samples of small inputs (files or directories)\n"
+                 "        -T  --test         Decompress a file or an archive in memory and check the checksum of each block\n"
+                 "        -s  --search       Print the occurrences of a pattern in a file or an archive, and the bytes around them\n"
+                 "        -D  --daemon       Run a daemon compressing the files sent with --via, on a Unix domain socket (not on Windows)\n"
+                 "            --daemon-metrics  Print the queue and latency metrics of a daemon\n"
+                 "            --daemon-stop     Stop a daemon once its running jobs are finished\n\n"
+
+                 "FLAGS:\n"
+                 "        --block-size SIZE        Compress in independent blocks of SIZE bytes (K, M, G suffixes), default 32M\n"
+                 "        --long-range             Replace repeats between distant blocks by references (needs the whole file in memory)\n"
+                 "        --rle                    Shorten runs of equal bytes of each block before the BWT\n"
+                 "        --words                  Replace the frequent words of each block by short codes before the BWT, for text\n"
+                 "        --numeric FILTER         Filter the records of numeric blocks before the BWT, none, auto or delta|xor|transpose:STRIDE[:WIDTH]\n"
+                 "        --adaptive               Choose BWT, Huffman or storing for each block by compressing a sample of it\n"
+                 "        --min-speed SPEED        Only choose the pipelines compressing the samples at SPEED MB/s at least (implies --adaptive)\n"
+                 "        --range OFFSET:LENGTH    Decompress only LENGTH bytes starting at OFFSET of the original file\n"
+                 "        --chunk-cache DIRECTORY  Split in content defined chunks, and reuse the blocks of the chunks compressed before\n"
+                 "        --via SOCKET             Compress or decompress with the daemon listening on SOCKET instead of this process\n"
+                 "        --index                  Store an FM-index with each block, so -s only decodes the parts it reads\n"
+                 "        --context SIZE           Bytes printed before and after each occurrence found by -s, default 32\n"
+                 "        --dictionary FILE        Compress or decompress with a trained dictionary, for inputs of a few KB\n"
+                 "        --dictionary-size SIZE   Maximum size of a trained dictionary, default 64K\n"
+                 "        --threads N              Number of threads of an archive or of the MTF of large blocks, default one per core\n"
+                 "        --cpu LEVEL              Run the SIMD kernels at scalar, sse4.2, avx2 or avx512 instead of the best level of the CPU\n"
+                 "        --stats json|text        Print time, throughput and memory of each stage to the standard error\n\n";
 
 }